@@ -0,0 +1,96 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "Compositor.h"
+
+#include <algorithm>    /* min(), max() */
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+/* Na začátku je potřeba vykreslit všechno */
+vector<SDL_Rect> Compositor::areas;
+bool Compositor::all = true;
+unsigned int Compositor::generation = 1;
+
+/* Poškození oblasti */
+void Compositor::damage(const SDL_Rect& area) {
+    if(all || area.w == 0 || area.h == 0) return;
+
+    areas.push_back(area);
+}
+
+/* Sloučení poškozených oblastí */
+vector<SDL_Rect>& Compositor::merge(SDL_Surface* screen) {
+    SDL_Rect whole = {0, 0, (*screen).w, (*screen).h};
+
+    if(all) {
+        areas.assign(1, whole);
+        return areas;
+    }
+
+    /* Oříznutí na velikost obrazovky, vyhození prázdných oblastí */
+    vector<SDL_Rect> clipped;
+    for(vector<SDL_Rect>::const_iterator it = areas.begin(); it != areas.end(); ++it) {
+        int left = max((int) (*it).x, 0), top = max((int) (*it).y, 0),
+            right = min((*it).x+(*it).w, (*screen).w), bottom = min((*it).y+(*it).h, (*screen).h);
+        if(left >= right || top >= bottom) continue;
+
+        SDL_Rect rect = {left, top, right-left, bottom-top};
+        clipped.push_back(rect);
+    }
+
+    /* Slučování oblastí, dokud se dají sloučit. Dvě oblasti se sloučí,
+       pokud jejich sjednocení není o moc větší než obě oblasti dohromady
+       (tj. překrývají se nebo jsou těsně vedle sebe). */
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(vector<SDL_Rect>::size_type i = 0; i < clipped.size() && !merged; ++i) {
+            for(vector<SDL_Rect>::size_type j = i+1; j < clipped.size(); ++j) {
+                SDL_Rect united = unite(clipped[i], clipped[j]);
+                if(size(united) > size(clipped[i])+size(clipped[j])+1024) continue;
+
+                clipped[i] = united;
+                clipped.erase(clipped.begin()+j);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    /* Příliš mnoho oblastí, sloučení do jedné */
+    if(clipped.size() > maxAreas) {
+        SDL_Rect united = clipped.front();
+        for(vector<SDL_Rect>::const_iterator it = clipped.begin()+1; it != clipped.end(); ++it)
+            united = unite(united, *it);
+        clipped.assign(1, united);
+    }
+
+    areas.swap(clipped);
+    return areas;
+}
+
+/* Sjednocení obdélníků */
+SDL_Rect Compositor::unite(const SDL_Rect& a, const SDL_Rect& b) {
+    int left = min(a.x, b.x), top = min(a.y, b.y),
+        right = max(a.x+a.w, b.x+b.w), bottom = max(a.y+a.h, b.y+b.h);
+
+    SDL_Rect united = {left, top, right-left, bottom-top};
+    return united;
+}
+
+}}
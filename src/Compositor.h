@@ -0,0 +1,113 @@
+#ifndef Kompas_Sdl_Compositor_h
+#define Kompas_Sdl_Compositor_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/**
+ * @file Compositor.h
+ * @brief Třída Compositor
+ */
+
+#include <vector>
+#include <SDL/SDL.h>
+
+namespace Kompas { namespace Sdl {
+
+/**
+ * @brief Sledování poškozených oblastí obrazovky
+ *
+ * Objekty při změně svého stavu (posun mapy, načtení dlaždice, změna aktuální
+ * položky, přebliknutí kurzoru...) nahlásí poškozenou oblast funkcí
+ * Compositor::damage. Scene::render pak překreslí jen poškozené oblasti
+ * (v každé zavolá view() viditelných objektů v pořadí odspodu nahoru) a
+ * pošle je na displej pomocí SDL_UpdateRects. Pokud se nic nezměnilo,
+ * nepřekresluje se nic.
+ *
+ * Objekty si také pamatují rozvržení (zarovnané oblasti sebe a svých
+ * položek) a přepočítávají ho, jen pokud se změnila generace rozvržení.
+ * Ta se zvýší funkcí Compositor::invalidateLayout při změně velikosti okna,
+ * načtení skinu apod.
+ *
+ * Funkce a vlastnosti jsou statické, aby byly použitelné globálně bez nutnosti
+ * instantace třídy.
+ */
+class Compositor {
+    public:
+        /**
+         * @brief Poškození oblasti
+         *
+         * @param   area    Poškozená oblast (může přesahovat obrazovku)
+         */
+        static void damage(const SDL_Rect& area);
+
+        /**
+         * @brief Poškození celé obrazovky
+         *
+         * Např. při změně velikosti okna nebo načtení skinu.
+         */
+        inline static void damage(void) { all = true; }
+
+        /** @brief Zda je nějaká oblast poškozená */
+        inline static bool damaged(void) { return all || !areas.empty(); }
+
+        /**
+         * @brief Sloučení poškozených oblastí
+         *
+         * Ořízne poškozené oblasti na velikost obrazovky a sloučí
+         * překrývající se a blízké oblasti. Pokud je oblastí příliš mnoho,
+         * sloučí je do jedné.
+         * @param   screen  Displejová surface
+         * @return  Oblasti k překreslení, platné do dalšího volání
+         *  Compositor::damage nebo Compositor::clear.
+         */
+        static std::vector<SDL_Rect>& merge(SDL_Surface* screen);
+
+        /** @brief Vymazání poškozených oblastí (po překreslení) */
+        inline static void clear(void) { all = false; areas.clear(); }
+
+        /**
+         * @brief Generace rozvržení
+         *
+         * Začíná na 1, objekty tedy mohou nulou označit, že rozvržení ještě
+         * nemají.
+         */
+        inline static unsigned int layoutGeneration(void) { return generation; }
+
+        /**
+         * @brief Změna rozvržení
+         *
+         * Zvýší generaci rozvržení a poškodí celou obrazovku. Volat při změně
+         * velikosti okna nebo načtení skinu.
+         */
+        inline static void invalidateLayout(void) { ++generation; all = true; }
+
+    private:
+        /** @brief Maximální počet oblastí, víc se jich sloučí do jedné */
+        static const std::vector<SDL_Rect>::size_type maxAreas = 16;
+
+        static std::vector<SDL_Rect> areas;     /**< @brief Poškozené oblasti */
+        static bool all;                        /**< @brief Zda je poškozená celá obrazovka */
+        static unsigned int generation;         /**< @brief Generace rozvržení */
+
+        /** @brief Plocha obdélníku */
+        inline static int size(const SDL_Rect& rect) { return rect.w*rect.h; }
+
+        /** @brief Nejmenší obdélník obsahující oba obdélníky */
+        static SDL_Rect unite(const SDL_Rect& a, const SDL_Rect& b);
+};
+
+}}
+
+#endif
@@ -15,137 +15,354 @@
 
 #include "ConfParser.h"
 
+#include <algorithm>    /* find(), lower_bound(), min() */
+#include <cctype>       /* isspace() */
+#include <cstdio>       /* rename(), remove() */
+#include <cstring>      /* memcmp(), memcpy() */
 #include <fstream>
 #include <iostream>
 #include <sstream>      /* std::istringstream */
-#include <cstring>      /* strcmp() */
+#include <sys/stat.h>
 
-#include "Utility/utilities.h"
+#include "MappedFile.h"
 
 using namespace std;
-using namespace Kompas::Utility;
 
 namespace Kompas { namespace Sdl {
 
-const int ConfParser::MAX_LINE_LENGTH = 256;
 const std::string ConfParser::DEFAULT_SECTION = "default";
+const std::string ConfParser::CACHE_EXTENSION = ".cache";
+bool ConfParser::cache = true;
+
+/* Verze formátu cache, velikost hlavičky a položky parametru (v bajtech) */
+static const unsigned int cacheVersion = 2;
+static const unsigned int cacheHeaderSize = 28;
+static const unsigned int cacheEntrySize = 32;
+
+/* Čtení a zápis čísel v cache. Cache je jen pro tento počítač, proto jsou
+   čísla v nativním pořadí bajtů, případná cache z jiné architektury
+   neprojde kontrolou verze. */
+static unsigned int read32(const unsigned char* position) {
+    unsigned int number;
+    memcpy(&number, position, 4);
+    return number;
+}
+
+static void write32(ostream& out, unsigned int number) {
+    out.write(reinterpret_cast<const char*>(&number), 4);
+}
+
+/* FNV-1a hash obsahu zdrojového souboru */
+static unsigned int contentHash(const unsigned char* data, unsigned int size) {
+    unsigned int hash = 2166136261u;
+    for(const unsigned char* end = data+size; data != end; ++data) {
+        hash ^= *data;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Značky komentáře a sekce, na které ukazují názvy parametrů */
+static const char commentMarker[] = "#";
+static const char sectionMarker[] = "[";
+
+/* Sdílené namapování souboru */
+struct ConfParser::Source {
+    MappedFile* file;           /* Namapovaný soubor */
+    unsigned int references;    /* Počet parserů, které soubor používají */
+};
+
+/* Úsek bez bílých znaků na začátku a konci */
+ConfParser::Slice ConfParser::Slice::trimmed(void) const {
+    const char *begin = data, *end = data+length;
+    while(begin != end && isspace((unsigned char) *begin)) ++begin;
+    while(end != begin && isspace((unsigned char) *(end-1))) --end;
+    return Slice(begin, end);
+}
+
+/* Porovnání úseků */
+bool ConfParser::Slice::operator==(const Slice& other) const {
+    return length == other.length && memcmp(data, other.data, length) == 0;
+}
+
+/* Řazení úseků */
+bool ConfParser::Slice::operator<(const Slice& other) const {
+    int result = memcmp(data, other.data, min(length, other.length));
+    return result < 0 || (result == 0 && length < other.length);
+}
 
 /* Konstruktor */
-ConfParser::ConfParser(std::string _file): filename(_file) {
-    std::ifstream file(_file.c_str());
-    if(!file.good()) {
+ConfParser::ConfParser(std::string _file): filename(_file), source(0) {
+    /* Změna zdrojového souboru se pozná podle času změny, velikosti a
+       hashe obsahu */
+    struct stat info;
+    if(stat(_file.c_str(), &info) != 0) {
+        cerr << "Nelze otevřít soubor " << _file << "." << endl;
+        return;
+    }
+
+    MappedFile* file = new MappedFile(_file);
+    if(!(*file).isValid()) {
         cerr << "Nelze otevřít soubor " << _file << "." << endl;
+        delete file;
         return;
     }
 
-    char buffer[ConfParser::MAX_LINE_LENGTH];
+    /* Platná cache, žádné parsování (hodnoty ukazují do cache, zdrojový
+       soubor už není potřeba) */
+    unsigned int hash = cache ? contentHash((*file).data(), (*file).size()) : 0;
+    if(cache && loadCache(_file + CACHE_EXTENSION, info.st_mtime, info.st_size, hash)) {
+        delete file;
+        reloadSections();
+        return;
+    }
+
+    source = new Source;
+    (*source).file = file;
+    (*source).references = 1;
+
+    const char* position = reinterpret_cast<const char*>((*file).data());
+    const char* end = position+(*file).size();
 
     /* BOM u UTF-8 */
-    if(file.peek() == 0xEF) {
-
-        char bom[4] = {
-            (unsigned char) 0xEF, (unsigned char) 0xBB,
-            (unsigned char) 0xBF, '\0'
-        };
-        file.get(buffer, 4);
-
-        /* Tak to BOM nebyl */
-        /** @todo zbavit se toho strcmp() */
-        if(strcmp(buffer, bom) != 0) {
-            file.seekg(0, std::ios::beg);
-        }
-    }
+    if(end-position >= 3 && memcmp(position, "\xEF\xBB\xBF", 3) == 0)
+        position += 3;
 
-    /* Naparsování */
-    while(file.good()) {
-        /* Komentář - musí být na začátku řádku bez mezer */
-        if(file.peek() == ';' || file.peek() == '#') {
-            file.ignore(1);
-            file.getline(buffer, ConfParser::MAX_LINE_LENGTH-1);
+    bool valid = parse(position, end);
 
-            /** @todo Error při nadlimitní velikosti */
+    /* Rozdělení konfiguráku na sekce */
+    reloadSections();
+
+    /* Uložení cache pro příští spuštění, jen pokud v souboru nebyly chyby,
+       aby se chybová hlášení neztratila */
+    if(cache && valid) saveCache(_file + CACHE_EXTENSION, info.st_mtime, info.st_size, hash);
+}
+
+/* Kopírovací konstruktor */
+ConfParser::ConfParser(const ConfParser& conf): filename(conf.filename), parameters(conf.parameters), source(conf.source) {
+    if(source) ++(*source).references;
+    reloadSections();
+}
+
+/* Naparsování */
+bool ConfParser::parse(const char* position, const char* end) {
+    const char* begin = position;
+
+    while(position != end) {
+        /* Komentář - musí být na začátku řádku bez mezer */
+        if(*position == ';' || *position == '#') {
+            const char* lineEnd = find(position+1, end, '\n');
 
             Parameter parameter;
-            parameter.parameter = "#";
-            parameter.value = buffer;
+            parameter.parameter = Slice(commentMarker, commentMarker+1);
+            parameter.value = Slice(position+1, lineEnd);
             parameters.push_back(parameter);
 
+            position = lineEnd == end ? end : lineEnd+1;
             continue;
         }
 
         /* Název sekce */
-        if(file.peek() == '[') {
-            file.ignore(1);
-            file.get(buffer, ConfParser::MAX_LINE_LENGTH-1, ']');
-            if(file.peek() != ']') {
-                cerr << "Neplatný název sekce " << buffer << " v souboru " << filename << "." << endl;
-                return;
+        if(*position == '[') {
+            const char* nameEnd = find(position+1, end, ']');
+            if(nameEnd == end) {
+                cerr << "Neplatný název sekce " << string(position+1, find(position+1, end, '\n')) << " v souboru " << filename << "." << endl;
+                return false;
             }
-            file.ignore(ConfParser::MAX_LINE_LENGTH, '\n');
 
             Parameter parameter;
-            parameter.parameter = "[";
-            parameter.value = buffer;
+            parameter.parameter = Slice(sectionMarker, sectionMarker+1);
+            parameter.value = Slice(position+1, nameEnd);
             parameters.push_back(parameter);
+
+            /* Zbytek řádku se ignoruje */
+            position = find(nameEnd, end, '\n');
+            if(position != end) ++position;
             continue;
         }
 
         /* Prázdný řádek nebo jiná píčovina */
-        if(file.peek() == '\r' || file.peek() == '\n') {
-            file.ignore(1);
+        if(*position == '\r' || *position == '\n') {
+            ++position;
             continue;
         }
 
-        /* Odentrování těsně před koncem souboru */
-        if(!file.good()) continue;
-
         /* Získání parametru */
-        file.get(buffer, ConfParser::MAX_LINE_LENGTH-1, '=');
-        if(file.peek() != '=') {
-            cerr << "Neplatný prázdný parametr " << buffer << " v souboru " << filename << " na pozici " << file.tellg() << "." << endl;
-            return;
+        const char* nameEnd = find(position, end, '=');
+        if(nameEnd == end) {
+            cerr << "Neplatný prázdný parametr " << string(position, find(position, end, '\n')) << " v souboru " << filename << " na pozici " << position-begin << "." << endl;
+            return false;
         }
-        file.ignore(1);
 
         /* Inicializace parametru */
         Parameter parameter;
-        parameter.parameter = trim(buffer);
+        parameter.parameter = Slice(position, nameEnd).trimmed();
+        position = nameEnd+1;
 
         /* Uvozovky */
-        if(file.peek() == '"' || file.peek() == '\'') {
-            char delimiter = file.peek();
-            file.ignore(1);
-            file.get(buffer, ConfParser::MAX_LINE_LENGTH-1, delimiter);
+        if(position != end && (*position == '"' || *position == '\'')) {
+            const char* valueEnd = find(position+1, end, *position);
 
             /* Chybějící koncové uvozovky! */
-            if(file.peek() != delimiter) {
+            if(valueEnd == end) {
                 cerr << "Neukončené uvozovky v souboru " << filename << " u parametru "
-                     << parameter.parameter << " (pozice " << file.tellg() << ")." << endl;
-                return;
-            } else {
-                file.ignore(ConfParser::MAX_LINE_LENGTH, '\n');
-
-                /* U parametru v uvozovkách se mezery neosekávají */
-                parameter.value = buffer;
+                     << parameter.parameter.str() << " (pozice " << position-begin << ")." << endl;
+                return false;
             }
+
+            /* U parametru v uvozovkách se mezery neosekávají */
+            parameter.value = Slice(position+1, valueEnd);
+
+            /* Zbytek řádku se ignoruje */
+            position = find(valueEnd, end, '\n');
+            if(position != end) ++position;
         }
 
         /* Hodnota bez uvozovek */
         else {
-            file.getline(buffer, ConfParser::MAX_LINE_LENGTH-1);
-            parameter.value = trim(buffer);
+            const char* lineEnd = find(position, end, '\n');
+            parameter.value = Slice(position, lineEnd).trimmed();
+            position = lineEnd == end ? end : lineEnd+1;
         }
 
         /* Doplnění hodnoty do parametru */
         parameters.push_back(parameter);
+    }
 
+    return true;
+}
+
+/* Načtení cache */
+bool ConfParser::loadCache(const string& file, unsigned int time, unsigned int size, unsigned int hash) {
+    MappedFile* mapped = new MappedFile(file);
+    const unsigned char* data = (*mapped).data();
+    unsigned int cacheSize = (*mapped).size();
+
+    /* Neplatná nebo zastaralá cache */
+    if(cacheSize < cacheHeaderSize || memcmp(data, "KCNF", 4) != 0 ||
+       read32(data+4) != cacheVersion || read32(data+8) != time || read32(data+12) != size ||
+       read32(data+16) != hash) {
+        delete mapped;
+        return false;
     }
 
-    /* Uzavření souboru */
-    file.close();
+    unsigned int count = read32(data+20), stringsSize = read32(data+24);
+    if((cacheSize-cacheHeaderSize)/cacheEntrySize < count ||
+       cacheSize-cacheHeaderSize-count*cacheEntrySize < stringsSize) {
+        delete mapped;
+        return false;
+    }
 
-    /* Rozdělení konfiguráku na sekce */
-    reloadSections();
+    const unsigned char* entry = data+cacheHeaderSize;
+    const char* strings = reinterpret_cast<const char*>(entry+count*cacheEntrySize);
+    parameters.reserve(count);
+    for(unsigned int i = 0; i != count; ++i, entry += cacheEntrySize) {
+        unsigned int nameOffset = read32(entry+4), nameLength = read32(entry+8),
+            valueOffset = read32(entry+12), valueLength = read32(entry+16);
+
+        /* Poškozená cache */
+        if(nameOffset > stringsSize || stringsSize-nameOffset < nameLength ||
+           valueOffset > stringsSize || stringsSize-valueOffset < valueLength) {
+            parameters.clear();
+            delete mapped;
+            return false;
+        }
+
+        Parameter parameter;
+        parameter.types = read32(entry);
+        if(parameter.types & TYPE_COMMENT)
+            parameter.parameter = Slice(commentMarker, commentMarker+1);
+        else if(parameter.types & TYPE_SECTION)
+            parameter.parameter = Slice(sectionMarker, sectionMarker+1);
+        else
+            parameter.parameter = Slice(strings+nameOffset, strings+nameOffset+nameLength);
+        parameter.value = Slice(strings+valueOffset, strings+valueOffset+valueLength);
+        parameter.number = read32(entry+20);
+        parameter.color = read32(entry+24);
+        parameter.align = (Align) read32(entry+28);
+        parameters.push_back(parameter);
+    }
+
+    source = new Source;
+    (*source).file = mapped;
+    (*source).references = 1;
+    return true;
+}
+
+/* Uložení cache */
+void ConfParser::saveCache(const string& file, unsigned int time, unsigned int size, unsigned int hash) const {
+    /* Pokud nelze zapisovat (např. read-only médium), cache prostě nebude */
+    string temporary = file + ".tmp";
+    ofstream out(temporary.c_str(), ios::out|ios::binary|ios::trunc);
+    if(!out.good()) return;
+
+    /* Hlavička */
+    out.write("KCNF", 4);
+    write32(out, cacheVersion);
+    write32(out, time);
+    write32(out, size);
+    write32(out, hash);
+    write32(out, parameters.size());
+
+    unsigned int stringsSize = 0;
+    for(vector<Parameter>::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+        stringsSize += (*it).parameter.length + (*it).value.length;
+    write32(out, stringsSize);
+
+    /* Parametry s předem zkonvertovanými hodnotami */
+    unsigned int offset = 0;
+    for(vector<Parameter>::const_iterator it = parameters.begin(); it != parameters.end(); ++it) {
+        unsigned int types = 0;
+        int number = 0, color = 0;
+        Align _align = ALIGN_DEFAULT;
+
+        if((*it).parameter.data == commentMarker) types |= TYPE_COMMENT;
+        else if((*it).parameter.data == sectionMarker) types |= TYPE_SECTION;
+        else {
+            string text = (*it).value.str();
+
+            istringstream numberStr(text);
+            if(numberStr >> number) types |= TYPE_NUMBER;
+            else number = 0;
+
+            istringstream colorStr(text);
+            if(colorStr.peek() == '#') colorStr.ignore(1);
+            if(colorStr >> std::hex >> color) types |= TYPE_COLOR;
+            else color = 0;
+
+            _align = align(text);
+            types |= TYPE_ALIGN;
+        }
+
+        write32(out, types);
+        write32(out, offset);
+        write32(out, (*it).parameter.length);
+        write32(out, offset+(*it).parameter.length);
+        write32(out, (*it).value.length);
+        write32(out, number);
+        write32(out, color);
+        write32(out, _align);
+        offset += (*it).parameter.length + (*it).value.length;
+    }
+
+    /* Tabulka řetězců */
+    for(vector<Parameter>::const_iterator it = parameters.begin(); it != parameters.end(); ++it) {
+        out.write((*it).parameter.data, (*it).parameter.length);
+        out.write((*it).value.data, (*it).value.length);
+    }
+
+    /* Nahrazení cache až po úplném zápisu (na Windows rename() existující
+       soubor nepřepíše) */
+    out.close();
+    if(out.fail()) {
+        remove(temporary.c_str());
+        return;
+    }
+    #ifdef _WIN32
+    remove(file.c_str());
+    #endif
+    if(rename(temporary.c_str(), file.c_str()) != 0)
+        remove(temporary.c_str());
 }
 
 /* Operátor přiřazení */
@@ -156,6 +373,8 @@ ConfParser& ConfParser::operator= (const ConfParser& conf) {
             destroy();
             filename = conf.filename;
             parameters = conf.parameters;
+            source = conf.source;
+            if(source) ++(*source).references;
             reloadSections();
         }
 
@@ -166,33 +385,57 @@ ConfParser& ConfParser::operator= (const ConfParser& conf) {
 void ConfParser::destroy(void) {
     parameters.clear();
     sections.clear();
+    sectionIndex.clear();
+
+    /* Poslední parser používající soubor, odmapování */
+    if(source && --(*source).references == 0) {
+        delete (*source).file;
+        delete source;
+    }
+    source = 0;
 }
 
 /* Nalezení sekcí v konfiguráku */
 void ConfParser::reloadSections(void) {
     /* Vyčištění sekcí (aby tam nezůstávaly staré pointery) */
     sections.clear();
+    sectionIndex.clear();
 
     /* Default sekce */
     Section section;
-    section.section = ConfParser::DEFAULT_SECTION;
+    section.section = Slice(ConfParser::DEFAULT_SECTION);
     section.begin = parameters.begin();
     sections.push_back(section);
 
     for(vector<Parameter>::const_iterator it = parameters.begin(); it != parameters.end(); ++it) {
-        if((*it).parameter == "[") {
+        if((*it).parameter.data == sectionMarker) {
             Section section;
             section.section = (*it).value;
             section.begin = it+1;
             sections.push_back(section);
         }
     }
+
+    /* Indexy sekcí a parametrů v nich. Indexují se všechny položky včetně
+       komentářů a názvu následující sekce, aby výsledky byly stejné jako
+       při procházení sekce od začátku do konce. */
+    for(vector<Section>::size_type i = 0; i != sections.size(); ++i) {
+        sectionIndex[sections[i].section].push_back(i);
+
+        ConfParser::parameterPointer end = (i == sections.size()-1) ? parameters.end() : sections[i+1].begin;
+        for(ConfParser::parameterPointer it = sections[i].begin; it != end; ++it)
+            sections[i].index[(*it).parameter].push_back(it-parameters.begin());
+    }
 }
 
 /* Nalezení sekce */
 ConfParser::sectionPointer ConfParser::section(const string& name, ConfParser::sectionPointer begin, int flags) const {
-    for(ConfParser::sectionPointer it = begin; it != sections.end(); ++it) {
-        if((*it).section == name) return it;
+    /* První sekce s tímto názvem od počátku hledání */
+    map<Slice, vector<vector<Section>::size_type> >::const_iterator found = sectionIndex.find(Slice(name));
+    if(found != sectionIndex.end()) {
+        vector<vector<Section>::size_type>::const_iterator position =
+            lower_bound(found->second.begin(), found->second.end(), (vector<Section>::size_type) (begin-sections.begin()));
+        if(position != found->second.end()) return sections.begin()+*position;
     }
 
     /* Nic nenalezeno, pokud hledáme poprvé, chybové hlášení */
@@ -202,60 +445,94 @@ ConfParser::sectionPointer ConfParser::section(const string& name, ConfParser::s
     return sections.end();
 }
 
-/* Nalezení textové hodnoty parametru */
-template<> ConfParser::parameterPointer ConfParser::value(const string& parameter, string& _value, ConfParser::sectionPointer section, ConfParser::parameterPointer begin, int flags) const {
+/* Nalezení parametru */
+ConfParser::parameterPointer ConfParser::findParameter(const string& parameter, ConfParser::sectionPointer section, ConfParser::parameterPointer begin, int flags) const {
     /* Nenalezená sekce */
     if(section == sections.end()) return parameters.end();
 
     /* Spočtení konce sekce */
     ConfParser::parameterPointer end = (section == sections.end()-1) ? parameters.end() : (*(section+1)).begin;
 
-    /* Procházení sekce */
-    for(ConfParser::parameterPointer it = begin; it != end; ++it) {
-        if((*it).parameter == parameter) {
-            _value = (*it).value;
-            return it;
+    /* Počátek hledání v sekci, první parametr s tímto názvem od počátku */
+    if(begin >= (*section).begin) {
+        map<Slice, Positions>::const_iterator found = (*section).index.find(Slice(parameter));
+        if(found != (*section).index.end()) {
+            Positions::const_iterator position = lower_bound(found->second.begin(),
+                found->second.end(), (vector<Parameter>::size_type) (begin-parameters.begin()));
+            if(position != found->second.end()) return parameters.begin()+*position;
         }
+
+    /* Počátek hledání před sekcí, procházení */
+    } else for(ConfParser::parameterPointer it = begin; it != end; ++it) {
+        if((*it).parameter == Slice(parameter)) return it;
     }
 
     /* Nic nenalezeno, pokud hledáme poprvé, vyhození hlášky */
     if(begin == (*section).begin && !(flags & SUPPRESS_ERRORS))
-        cerr << "Hodnota parametru '" << parameter << "' nebyla v sekci [" << (*section).section << "] souboru '" << filename << "' nalezena." << endl;
+        cerr << "Hodnota parametru '" << parameter << "' nebyla v sekci [" << (*section).section.str() << "] souboru '" << filename << "' nalezena." << endl;
 
     return parameters.end();
 }
 
+/* Nalezení textové hodnoty parametru */
+template<> ConfParser::parameterPointer ConfParser::value(const string& parameter, string& _value, ConfParser::sectionPointer section, ConfParser::parameterPointer begin, int flags) const {
+    ConfParser::parameterPointer position = findParameter(parameter, section, begin, flags);
+    if(position != parameters.end()) _value = (*position).value.str();
+
+    return position;
+}
+
+/* Konverze textu na zarovnání */
+Align ConfParser::align(const string& text) {
+    istringstream str(text);
+    string keyword;
+    Align _value = (Align) 0;
+    while(str >> keyword) {
+             if(keyword == "left")      _value = (Align) (_value | ALIGN_LEFT);
+        else if(keyword == "center")    _value = (Align) (_value | ALIGN_CENTER);
+        else if(keyword == "right")     _value = (Align) (_value | ALIGN_RIGHT);
+        else if(keyword == "top")       _value = (Align) (_value | ALIGN_TOP);
+        else if(keyword == "middle")    _value = (Align) (_value | ALIGN_MIDDLE);
+        else if(keyword == "bottom")    _value = (Align) (_value | ALIGN_BOTTOM);
+    }
+
+    return _value;
+}
+
 /* Nalezení zarovnání */
 template<> ConfParser::parameterPointer ConfParser::value(const string& parameter, Align& _value, ConfParser::sectionPointer section, ConfParser::parameterPointer begin, int flags) const {
-    string __value;
-    ConfParser::parameterPointer position = value(parameter, __value, section, begin);
+    ConfParser::parameterPointer position = findParameter(parameter, section, begin, 0);
 
-    /* pokud bylo něco nalezeno */
-    if(position != parameters.end()) {
-        istringstream str(__value);
-        string keyword;
-        _value = (Align) 0;
-        while(str >> keyword) {
-                 if(keyword == "left")      _value = (Align) (_value | ALIGN_LEFT);
-            else if(keyword == "center")    _value = (Align) (_value | ALIGN_CENTER);
-            else if(keyword == "right")     _value = (Align) (_value | ALIGN_RIGHT);
-            else if(keyword == "top")       _value = (Align) (_value | ALIGN_TOP);
-            else if(keyword == "middle")    _value = (Align) (_value | ALIGN_MIDDLE);
-            else if(keyword == "bottom")    _value = (Align) (_value | ALIGN_BOTTOM);
-        }
-    }
+    /* pokud bylo něco nalezeno, předem zkonvertovaná hodnota z cache nebo
+       konverze textu */
+    if(position != parameters.end())
+        _value = (*position).types & TYPE_ALIGN ? (*position).align : align((*position).value.str());
 
     return position;
 }
 
+/* Předem zkonvertované číslo */
+bool ConfParser::typedValue(const Parameter& parameter, int& _value, int flags) {
+    if(flags == 0 && parameter.types & TYPE_NUMBER) {
+        _value = parameter.number;
+        return true;
+    }
+
+    if(flags == ConfParser::COLOR && parameter.types & TYPE_COLOR) {
+        _value = parameter.color;
+        return true;
+    }
+
+    return false;
+}
+
 /* Nalezení int / double hodnoty parametru */
 template<class Value> ConfParser::parameterPointer ConfParser::value(const string& parameter, Value& _value, ConfParser::sectionPointer section, ConfParser::parameterPointer begin, int flags) const {
-    string __value;
-    ConfParser::parameterPointer position = value(parameter, __value, section, begin);
+    ConfParser::parameterPointer position = findParameter(parameter, section, begin, 0);
 
-    /* pokud bylo něco nalezeno */
-    if(position != parameters.end()) {
-        istringstream str(__value);
+    /* pokud bylo něco nalezeno (a není to už zkonvertované v cache) */
+    if(position != parameters.end() && !typedValue(*position, _value, flags)) {
+        istringstream str((*position).value.str());
 
         /* Hexadecimální hodnota */
         if(flags == ConfParser::HEX)    str >> std::hex >> _value;
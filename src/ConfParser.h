@@ -20,6 +20,7 @@
  * @brief Třída ConfParser
  */
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,20 @@ namespace Kompas { namespace Sdl {
  *
  * Podrobný popis syntaxe conf souborů a způsobu získávání hodnot v samostané
  * sekci @ref ConfParser.
+ *
+ * Soubor je namapován do paměti (viz MappedFile) a naparsován jedním
+ * průchodem. Názvy a hodnoty parametrů se nekopírují, jsou uloženy jen jako
+ * úseky namapované paměti a do std::string se převádí až při získání
+ * hodnoty. Kopie parseru sdílejí jedno namapování, soubor se odmapuje
+ * se zničením poslední kopie.
+ *
+ * Naparsovaný soubor se uloží do binární cache vedle něj (viz
+ * ConfParser::CACHE_EXTENSION), při dalším spuštění se místo parsování
+ * jen namapuje cache, pokud odpovídá čas změny, velikost a hash obsahu
+ * zdrojového souboru (čas změny má rozlišení sekundy, úprava se stejnou
+ * délkou ve stejné sekundě by jinak prošla). Cache obsahuje tabulku
+ * řetězců, seznam parametrů a jejich předem zkonvertované hodnoty (celá
+ * čísla, barvy, zarovnání).
  * @todo Testovat parametry jen na alfanumerické znaky
  * @todo Ošetřit escape znaky
  * @todo Default sekce jen když obsahuje nějaké parametry
@@ -39,18 +54,81 @@ namespace Kompas { namespace Sdl {
  */
 class ConfParser {
     private:
+        /** @brief Úsek namapovaného souboru */
+        struct Slice {
+            const char* data;               /**< @brief Začátek úseku */
+            std::string::size_type length;  /**< @brief Délka úseku */
+
+            /** @brief Prázdný úsek */
+            inline Slice(void): data(0), length(0) {}
+
+            /** @brief Úsek od @c begin do @c end (bez něj) */
+            inline Slice(const char* begin, const char* end): data(begin), length(end-begin) {}
+
+            /**
+             * @brief Úsek nad řetězcem
+             *
+             * Platný jen po dobu existence řetězce (použitelné pro hledání
+             * v indexech).
+             */
+            inline Slice(const std::string& str): data(str.data()), length(str.size()) {}
+
+            /** @brief Převod na řetězec */
+            inline std::string str(void) const { return std::string(data, length); }
+
+            /** @brief Úsek bez počátečních a koncových bílých znaků */
+            Slice trimmed(void) const;
+
+            /** @brief Porovnání */
+            bool operator==(const Slice& other) const;
+
+            /** @brief Řazení (lexikograficky) */
+            bool operator<(const Slice& other) const;
+        };
+
+        /** @brief Sdílené namapování souboru */
+        struct Source;
+
+        /** @brief Typy předem zkonvertovaných hodnot parametru */
+        enum Types {
+            TYPE_COMMENT = 0x01,    /**< @brief Parametr je komentář */
+            TYPE_SECTION = 0x02,    /**< @brief Parametr je název sekce */
+            TYPE_NUMBER = 0x04,     /**< @brief Celé číslo je platné */
+            TYPE_COLOR = 0x08,      /**< @brief Barva je platná */
+            TYPE_ALIGN = 0x10       /**< @brief Zarovnání je platné */
+        };
+
         /** @brief Parametr konfiguračního souboru */
         struct Parameter {
-            std::string parameter,  /**< @brief Parametr */
-                        value;      /**< @brief Hodnota */
+            Slice parameter,        /**< @brief Parametr */
+                  value;            /**< @brief Hodnota */
+
+            /**
+             * @brief Předem zkonvertované hodnoty (viz ConfParser::Types)
+             *
+             * Nastavené jen u parametrů načtených z cache.
+             */
+            unsigned int types;
+            int number,             /**< @brief Celé číslo */
+                color;              /**< @brief Barva */
+            Align align;            /**< @brief Zarovnání */
+
+            /** @brief Konstruktor */
+            inline Parameter(void): types(0), number(0), color(0), align(ALIGN_DEFAULT) {}
         };
 
+        /** @brief Pozice parametrů se stejným názvem (vzestupně) */
+        typedef std::vector<std::vector<Parameter>::size_type> Positions;
+
         /** @brief Sekce konfiguračního souboru */
         struct Section {
-            std::string section;    /**< @brief Název sekce */
+            Slice section;          /**< @brief Název sekce */
 
             /** @brief Ukazatel na první parametr v sekci */
             std::vector<Parameter>::const_iterator begin;
+
+            /** @brief Index parametrů v sekci podle názvu */
+            std::map<Slice, Positions> index;
         };
     public:
         /** @brief Flags */
@@ -60,12 +138,20 @@ class ConfParser {
             COLOR = 0x04    /**< @brief Vybírat číslo reprezentující barvu (ff3366 i s # na začátku, na velikosti písem nezáleží). */
         };
 
-        /** @brief Maximální délka komentáře, názvu sekce, parametru nebo hodnoty parametru */
-        static const int MAX_LINE_LENGTH;
-
         /** @brief Název první sekce v konfiguráku */
         static const std::string DEFAULT_SECTION;
 
+        /** @brief Přípona souboru s binární cache */
+        static const std::string CACHE_EXTENSION;
+
+        /**
+         * @brief Zda používat binární cache
+         *
+         * Defaultně zapnuto. Při vypnutí se soubory vždy parsují a cache
+         * se neukládá.
+         */
+        static bool cache;
+
         /** @brief Ukazatel na sekci */
         typedef std::vector<Section>::const_iterator sectionPointer;
 
@@ -95,7 +181,7 @@ class ConfParser {
         inline sectionPointer sectionNotFound() const { return sections.end(); }
 
         /** @brief Implicitní konstruktor */
-        ConfParser(void) {}
+        inline ConfParser(void): source(0) {}
 
         /**
          * @brief Konstruktor
@@ -118,11 +204,10 @@ class ConfParser {
          *
          * Při kopírování do čistého objektu se musí reloadovat iterátory
          * ukazující na sekce, aby při zrušení původce dat nedošlo k segfault.
+         * Namapovaný soubor je sdílený.
          * @param   conf    Kopírovaný objekt
          */
-        inline ConfParser(const ConfParser& conf): filename(conf.filename), parameters(conf.parameters) {
-            reloadSections();
-        }
+        ConfParser(const ConfParser& conf);
 
         /**
          * @brief Operátor přiřazení
@@ -231,19 +316,81 @@ class ConfParser {
         std::string filename;               /**< @brief Jméno souboru s konfigurákem */
         std::vector<Parameter> parameters;  /**< @brief Vektor s parametry a komentáři */
         std::vector<Section> sections;      /**< @brief Vektor s názvy a pozicemi sekcí */
+        Source* source;                     /**< @brief Namapovaný soubor, do kterého ukazují parametry */
+
+        /** @brief Index sekcí podle názvu (pozice ve vektoru sekcí, vzestupně) */
+        std::map<Slice, std::vector<std::vector<Section>::size_type> > sectionIndex;
+
+        /**
+         * @brief Naparsování namapovaného souboru
+         *
+         * @param   position    Začátek dat (za případnou UTF-8 signaturou)
+         * @param   end         Konec dat
+         * @return  Zda byl soubor bez chyb
+         */
+        bool parse(const char* position, const char* end);
+
+        /**
+         * @brief Načtení binární cache
+         *
+         * @param   file        Soubor s cache
+         * @param   time        Čas poslední změny zdrojového souboru
+         * @param   size        Velikost zdrojového souboru
+         * @param   hash        Hash obsahu zdrojového souboru
+         * @return  Zda byla cache platná a načetla se
+         */
+        bool loadCache(const std::string& file, unsigned int time, unsigned int size, unsigned int hash);
+
+        /**
+         * @brief Uložení binární cache
+         *
+         * @param   file        Soubor s cache
+         * @param   time        Čas poslední změny zdrojového souboru
+         * @param   size        Velikost zdrojového souboru
+         * @param   hash        Hash obsahu zdrojového souboru
+         *
+         * Cache se zapíše do dočasného souboru a až po úspěšném zápisu se
+         * přejmenuje, takže pád během zápisu nezanechá poškozenou cache.
+         */
+        void saveCache(const std::string& file, unsigned int time, unsigned int size, unsigned int hash) const;
+
+        /**
+         * @brief Předem zkonvertovaná hodnota
+         *
+         * Pro jiné typy než int vždy vrací false.
+         * @return  Zda byla hodnota v parametru zkonvertovaná
+         */
+        template<class Value> inline static bool typedValue(const Parameter&, Value&, int) { return false; }
+
+        /** @overload */
+        static bool typedValue(const Parameter& parameter, int& _value, int flags);
+
+        /** @brief Konverze textu na zarovnání */
+        static Align align(const std::string& text);
+
+        /**
+         * @brief Nalezení parametru
+         *
+         * Společná část všech funkcí ConfParser::value, hodnota parametru se
+         * nepřevádí na řetězec.
+         */
+        parameterPointer findParameter(const std::string& parameter, sectionPointer section, parameterPointer begin, int flags) const;
 
         /**
          * @brief (Znovu)nalezení sekcí v konfiguráku
          *
          * Interně jsou na pozice sekcí používány iterátory, při změně dat (načtení
-         * souboru) jsou rozházeny a musí se znovu nalézt.
+         * souboru) jsou rozházeny a musí se znovu nalézt. Zároveň se vytvoří
+         * index sekcí a parametrů podle názvu, takže hledání nemusí procházet
+         * celý soubor.
          */
         void reloadSections(void);
 
         /**
          * @brief Zničení objektu
          *
-         * Uvolnění všech dat.
+         * Uvolnění všech dat, odmapování souboru, pokud jej už nepoužívá
+         * žádná jiná kopie.
          */
         void destroy(void);
 };
@@ -277,19 +424,16 @@ a konci řádku nehrají roli. Pokud je na začátku souboru nalezena UTF8 signa
 detekována a přeskočena.
 @subsection ConfSyntaxComments Komentáře
 Komentář musí vždy začínat znakem <tt>\#</tt> nebo <tt>;</tt> na začátku řádku.
-Komentář může být maximálně dlouhý ConfParser::MAX_LINE_LENGTH znaků.
 @subsection ConfSyntaxSections Sekce
 Název sekce je ohraničen znaky <tt>[</tt> a <tt>]</tt>, vše co následuje za
 tímto řádkem, patří do této sekce, dokud se nedosáhne řádku s názvem další
 sekce. Pokud jsou před první sekcí uvedeny parametry, patří do sekce pojmenované
-ConfParser::DEFAULT_SECTION. Maximální délka názvu sekce je
-ConfParser::MAX_LINE_LENGTH znaků.
+ConfParser::DEFAULT_SECTION.
 @subsection ConfSyntaxParameters Parametry a hodnoty (tj. vlastní data)
 Název parametru je vše co je před znakem <tt>=</tt> (kromě úvodních mezer na
-řádku), jeho délka je omezena na ConfParser::MAX_LINE_LENGTH znaků. Hodnota může
-být uzavřena do uvozovek <tt>"</tt> nebo apostrofů <tt>'</tt>, pokud není, jsou
-u ní osekány počáteční a koncové mezery. Maximální délka hodnoty je taktéž
-ConfParser::MAX_LINE_LENGTH znaků.
+řádku). Hodnota může být uzavřena do uvozovek <tt>"</tt> nebo apostrofů
+<tt>'</tt>, pokud není, jsou u ní osekány počáteční a koncové mezery. Délka
+řádků není nijak omezena.
 @section ConfDataTypes Druhy hodnot
 V conf souboru můžou být parametry typu @ref ConfTypeInt, @ref ConfTypeDouble,
 @ref ConfTypeBool, @ref ConfTypeString a @ref ConfTypeAlign. Je možné jakýkoli
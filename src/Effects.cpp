@@ -15,11 +15,31 @@
 
 #include "Effects.h"
 
+#include <algorithm>    /* min(), max() */
+
+using namespace std;
+
 namespace Kompas { namespace Sdl {
 
 /* Vyhlazení textu je defaultně zapnuto */
 bool Effects::smoothText = true;
 
+map<Effects::GlyphKey, Effects::Glyph> Effects::glyphs;
+map<Effects::GlyphKey, Effects::GlyphMetrics> Effects::metrics;
+map<Effects::GlyphKey, int> Effects::kerning;
+vector<SDL_Surface*> Effects::atlasPages;
+list<Effects::CachedText> Effects::texts;
+map<Effects::TextKey, list<Effects::CachedText>::iterator> Effects::textIndex;
+bool Effects::textCacheSmoothText = true;
+unsigned int Effects::textCacheSize = 256;
+unsigned int Effects::textCacheUsed = 0;
+unsigned int Effects::_textCacheHits = 0;
+unsigned int Effects::_textCacheMisses = 0;
+unsigned int Effects::_textCacheEvictions = 0;
+int Effects::atlasX = 0;
+int Effects::atlasY = 0;
+int Effects::atlasShelfHeight = 0;
+
 /* Zarovnání objektu */
 SDL_Rect Effects::align (const SDL_Rect& area, Align _align, int objectW, int objectH, int moveX, int moveY, SDL_Rect* crop) {
     /* Ořezový obdélník */
@@ -61,4 +81,332 @@ SDL_Rect Effects::align (const SDL_Rect& area, Align _align, int objectW, int ob
     return ret;
 }
 
+/* Porovnání klíčů glyphů */
+bool Effects::GlyphKey::operator<(const GlyphKey& other) const {
+    if(font != other.font) return font < other.font;
+    if(character != other.character) return character < other.character;
+    if(color != other.color) return color < other.color;
+    return smooth < other.smooth;
+}
+
+/* Porovnání klíčů textů */
+bool Effects::TextKey::operator<(const TextKey& other) const {
+    if(font != other.font) return font < other.font;
+    if(color != other.color) return color < other.color;
+    return *text < *other.text;
+}
+
+/* Rozměry textu */
+void Effects::textSize(TTF_Font* font, const string& text, int& w, int& h) {
+    int left;
+    textBounds(font, text, left, w, h);
+}
+
+/* Rozměry a levý okraj textu */
+void Effects::textBounds(TTF_Font* font, const string& text, int& left, int& w, int& h) {
+    h = TTF_FontHeight(font);
+
+    /* Glyphy mohou přesahovat pozici pera doleva (záporné minx) i doprava
+       za posun pera (kurzíva) */
+    int pen = 0, right = 0;
+    left = 0;
+    Uint16 previous = 0;
+    for(string::size_type i = 0; i < text.size(); ) {
+        Uint16 character = nextCharacter(text, i);
+        const GlyphMetrics& m = glyphMetrics(font, character);
+
+        if(previous != 0) pen += kerningSize(font, previous, character);
+        if(m.maxx > m.minx) {
+            left = min(left, pen+m.minx);
+            right = max(right, pen+m.maxx);
+        }
+        pen += m.advance;
+        previous = character;
+    }
+
+    w = max(pen, right)-left;
+}
+
+/* Vykreslení textu */
+void Effects::blitText(TTF_Font* font, const string& text, SDL_Color color, const SDL_Rect* crop, SDL_Surface* destination, const SDL_Rect* position) {
+    SDL_Surface* surface = cachedText(font, text, color);
+    if(surface == NULL) return;
+
+    SDL_Rect source = {0, 0, (*surface).w, (*surface).h};
+    if(crop != NULL) source = *crop;
+    SDL_Rect target = *position;
+    SDL_BlitSurface(surface, &source, destination, &target);
+}
+
+/* Text z cache */
+SDL_Surface* Effects::cachedText(TTF_Font* font, const string& text, SDL_Color color) {
+    if(text.empty()) return NULL;
+
+    /* Změnilo se vyhlazování, všechny texty jsou neplatné. Glyphy v atlasu
+       mají vyhlazení v klíči, ty zůstávají. */
+    if(smoothText != textCacheSmoothText) {
+        for(list<CachedText>::const_iterator it = texts.begin(); it != texts.end(); ++it)
+            SDL_FreeSurface((*it).surface);
+        texts.clear();
+        textIndex.clear();
+        textCacheUsed = 0;
+        textCacheSmoothText = smoothText;
+    }
+
+    TextKey key;
+    key.font = font;
+    key.color = color.r << 16 | color.g << 8 | color.b;
+    key.text = &text;
+
+    /* Text je v cache, přesunutí na začátek */
+    map<TextKey, list<CachedText>::iterator>::const_iterator found = textIndex.find(key);
+    if(found != textIndex.end()) {
+        ++_textCacheHits;
+        texts.splice(texts.begin(), texts, (*found).second);
+        return (*texts.begin()).surface;
+    }
+
+    ++_textCacheMisses;
+
+    /* Složení textu z glyphů do průhledné surface, glyph přesahující doleva
+       posune text doprava */
+    int left, w, h;
+    textBounds(font, text, left, w, h);
+    if(w <= 0 || h <= 0) return NULL;
+    SDL_Surface* surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if(surface == NULL) return NULL;
+    SDL_Rect position = {0, 0, 0, 0};
+    position.x = -left;
+    blitGlyphs(font, text, color, NULL, surface, &position, true);
+
+    /* Uložení do cache, index ukazuje na text uložený v cache */
+    CachedText cached;
+    cached.text = text;
+    cached.surface = surface;
+    texts.push_front(cached);
+    (*texts.begin()).key = key;
+    (*texts.begin()).key.text = &(*texts.begin()).text;
+    textIndex[(*texts.begin()).key] = texts.begin();
+    textCacheUsed += textSurfaceSize(surface);
+
+    /* Vyhození nejdéle nepoužitých textů (právě složený zůstane) */
+    while(textCacheUsed > textCacheSize*1024 && texts.size() > 1) {
+        textCacheUsed -= textSurfaceSize(texts.back().surface);
+        SDL_FreeSurface(texts.back().surface);
+        textIndex.erase(texts.back().key);
+        texts.pop_back();
+        ++_textCacheEvictions;
+    }
+
+    return surface;
+}
+
+/* Vykreslení textu po glyphech */
+void Effects::blitGlyphs(TTF_Font* font, const string& text, SDL_Color color, const SDL_Rect* crop, SDL_Surface* destination, const SDL_Rect* position, bool copyAlpha) {
+    /* Ořezový obdélník v souřadnicích textu */
+    int cropX = 0, cropY = 0, cropW = 0xFFFF, cropH = 0xFFFF;
+    if(crop != NULL) {
+        cropX = (*crop).x; cropY = (*crop).y;
+        cropW = (*crop).w; cropH = (*crop).h;
+    }
+
+    int pen = 0;
+    Uint16 previous = 0;
+    for(string::size_type i = 0; i < text.size(); ) {
+        Uint16 character = nextCharacter(text, i);
+        const Glyph& g = glyph(font, color, character);
+
+        if(previous != 0) pen += kerningSize(font, previous, character);
+        previous = character;
+
+        /* Oblast glyphu v souřadnicích textu, oříznutí */
+        int x = pen+g.x, y = g.y, w = g.area.w, h = g.area.h;
+        pen += g.advance;
+        if(g.page == NULL) continue;
+
+        int left = max(x, cropX), top = max(y, cropY),
+            right = min(x+w, cropX+cropW), bottom = min(y+h, cropY+cropH);
+        if(left >= right || top >= bottom) continue;
+
+        SDL_Rect source = {g.area.x+left-x, g.area.y+top-y, right-left, bottom-top};
+        SDL_Rect target = {(*position).x+left-cropX, (*position).y+top-cropY, 0, 0};
+        if(copyAlpha) copyGlyph(g.page, source, destination, target.x, target.y);
+        else SDL_BlitSurface(g.page, &source, destination, &target);
+    }
+}
+
+/* Zkopírování glyphu s maximem průhlednosti */
+void Effects::copyGlyph(SDL_Surface* page, const SDL_Rect& area, SDL_Surface* destination, int x, int y) {
+    /* Oříznutí na cílovou surface */
+    int skipX = max(0, -x), skipY = max(0, -y),
+        w = min((int) area.w, (*destination).w-x), h = min((int) area.h, (*destination).h-y);
+    if(skipX >= w || skipY >= h) return;
+
+    SDL_LockSurface(page);
+    SDL_LockSurface(destination);
+    for(int row = skipY; row != h; ++row) {
+        const Uint32* source = reinterpret_cast<const Uint32*>(static_cast<Uint8*>((*page).pixels)
+            + (area.y+row)*(*page).pitch) + area.x;
+        Uint32* target = reinterpret_cast<Uint32*>(static_cast<Uint8*>((*destination).pixels)
+            + (y+row)*(*destination).pitch) + x;
+
+        for(int col = skipX; col != w; ++col)
+            if((source[col] & 0xFF000000) > (target[col] & 0xFF000000))
+                target[col] = source[col];
+    }
+    SDL_UnlockSurface(destination);
+    SDL_UnlockSurface(page);
+}
+
+/* Uvolnění atlasu glyphů a cache textů */
+void Effects::clearTextCache(void) {
+    for(list<CachedText>::const_iterator it = texts.begin(); it != texts.end(); ++it)
+        SDL_FreeSurface((*it).surface);
+    texts.clear();
+    textIndex.clear();
+    textCacheUsed = 0;
+
+    for(vector<SDL_Surface*>::const_iterator it = atlasPages.begin(); it != atlasPages.end(); ++it)
+        SDL_FreeSurface(*it);
+
+    atlasPages.clear();
+    glyphs.clear();
+    metrics.clear();
+    kerning.clear();
+    atlasX = atlasY = atlasShelfHeight = 0;
+}
+
+/* Glyph z atlasu */
+const Effects::Glyph& Effects::glyph(TTF_Font* font, SDL_Color color, Uint16 character) {
+    GlyphKey key;
+    key.font = font;
+    key.color = color.r << 16 | color.g << 8 | color.b;
+    key.smooth = smoothText;
+    key.character = character;
+
+    map<GlyphKey, Glyph>::const_iterator found = glyphs.find(key);
+    if(found != glyphs.end()) return (*found).second;
+
+    Glyph& g = glyphs[key];
+    g.page = NULL;
+    g.area.x = g.area.y = g.area.w = g.area.h = 0;
+    g.x = g.y = g.advance = 0;
+
+    int minx, maxx, miny, maxy;
+    if(TTF_GlyphMetrics(font, character, &minx, &maxx, &miny, &maxy, &g.advance) != 0)
+        return g;
+
+    /* Glyph se umisťuje stejně jako v TTF_RenderUTF8_* */
+    g.x = minx;
+    g.y = TTF_FontAscent(font)-maxy;
+
+    SDL_Surface* rendered = smoothText ?
+        TTF_RenderGlyph_Blended(font, character, color) :
+        TTF_RenderGlyph_Solid(font, character, color);
+
+    /* Prázdný glyph (mezera) */
+    if(rendered == NULL) return g;
+    if((*rendered).w == 0 || (*rendered).h == 0) {
+        SDL_FreeSurface(rendered);
+        return g;
+    }
+
+    /* Glyph se nevejde do aktuální police, nová police */
+    if(!atlasPages.empty() && atlasX+(*rendered).w > (*atlasPages.back()).w) {
+        atlasX = 0;
+        atlasY += atlasShelfHeight;
+        atlasShelfHeight = 0;
+    }
+
+    /* Glyph se nevejde do aktuální stránky, nová stránka (pro glyph větší
+       než stránka vlastní, do které se už nic dalšího nevejde) */
+    if(atlasPages.empty() || atlasY+(*rendered).h > (*atlasPages.back()).h) {
+        atlasPages.push_back(SDL_CreateRGBSurface(SDL_SWSURFACE,
+            max(atlasPageSize, (*rendered).w), max(atlasPageSize, (*rendered).h), 32,
+            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000));
+        atlasX = atlasY = atlasShelfHeight = 0;
+    }
+
+    g.page = atlasPages.back();
+    g.area.x = atlasX;
+    g.area.y = atlasY;
+    g.area.w = (*rendered).w;
+    g.area.h = (*rendered).h;
+
+    /* Zkopírování glyphu i s průhledností (vyhlazený glyph bez blendingu,
+       u nevyhlazeného se kopírují jen pixely bez colorkey) */
+    if(smoothText) SDL_SetAlpha(rendered, 0, SDL_ALPHA_OPAQUE);
+    SDL_Rect target = g.area;
+    SDL_BlitSurface(rendered, NULL, g.page, &target);
+    SDL_FreeSurface(rendered);
+
+    atlasX += g.area.w;
+    atlasShelfHeight = max(atlasShelfHeight, (int) g.area.h);
+
+    return g;
+}
+
+/* Metriky znaku */
+const Effects::GlyphMetrics& Effects::glyphMetrics(TTF_Font* font, Uint16 character) {
+    GlyphKey key;
+    key.font = font;
+    key.color = 0;
+    key.smooth = false;
+    key.character = character;
+
+    map<GlyphKey, GlyphMetrics>::const_iterator found = metrics.find(key);
+    if(found != metrics.end()) return (*found).second;
+
+    GlyphMetrics& m = metrics[key];
+    int miny, maxy;
+    m.minx = m.maxx = m.advance = 0;
+    if(TTF_GlyphMetrics(font, character, &m.minx, &m.maxx, &miny, &maxy, &m.advance) != 0)
+        m.minx = m.maxx = m.advance = 0;
+    return m;
+}
+
+/* Vyrovnání mezi dvěma znaky */
+int Effects::kerningSize(TTF_Font* font, Uint16 previous, Uint16 character) {
+    #if SDL_TTF_MAJOR_VERSION*10000+SDL_TTF_MINOR_VERSION*100+SDL_TTF_PATCHLEVEL >= 20011
+    GlyphKey key;
+    key.font = font;
+    key.color = previous;
+    key.smooth = false;
+    key.character = character;
+
+    map<GlyphKey, int>::const_iterator found = kerning.find(key);
+    if(found != kerning.end()) return (*found).second;
+
+    return kerning[key] = TTF_GetFontKerningSize(font,
+        TTF_GlyphIsProvided(font, previous), TTF_GlyphIsProvided(font, character));
+    #else
+    /* Starší SDL_ttf neumí zjistit vyrovnání jednotlivých párů */
+    return 0;
+    #endif
+}
+
+/* Další znak UTF-8 řetězce */
+Uint16 Effects::nextCharacter(const string& text, string::size_type& position) {
+    unsigned char first = text[position++];
+    if(first < 0x80) return first;
+
+    /* Délka sekvence podle prvního bajtu */
+    unsigned int length, character;
+    if((first & 0xE0) == 0xC0) { length = 1; character = first & 0x1F; }
+    else if((first & 0xF0) == 0xE0) { length = 2; character = first & 0x0F; }
+    else {
+        /* Přeskočení zbytku sekvence */
+        while(position != text.size() && (text[position] & 0xC0) == 0x80) ++position;
+        return '?';
+    }
+
+    for(; length != 0; --length) {
+        if(position == text.size() || (text[position] & 0xC0) != 0x80) return '?';
+        character = character << 6 | (text[position++] & 0x3F);
+    }
+
+    return character;
+}
+
 }}
@@ -20,6 +20,10 @@
  * @brief Třída Effects
  */
 
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 
@@ -124,6 +128,199 @@ class Effects {
          inline static SDL_Surface* (*textRenderFunction(void))(TTF_Font*, const char*, SDL_Color) {
             return Effects::smoothText ? TTF_RenderUTF8_Blended : TTF_RenderUTF8_Solid;
          }
+
+        /**
+         * @brief Rozměry textu
+         *
+         * Rozměry textu vykreslovaného funkcí Effects::blitText.
+         * @param   font        Font
+         * @param   text        Text v UTF-8
+         * @param   w           Kam uložit šířku
+         * @param   h           Kam uložit výšku
+         */
+        static void textSize(TTF_Font* font, const std::string& text, int& w, int& h);
+
+        /**
+         * @brief Vykreslení textu
+         *
+         * Obdoba SDL_BlitSurface pro text, který by vyrenderovala funkce
+         * Effects::textRenderFunction. Text se skládá z glyphů uložených v
+         * atlasu, každý glyph se vyrenderuje jen jednou (pro každou
+         * kombinaci fontu, barvy a vyhlazení). Složený text se uloží do
+         * cache, takže opakované vykreslení téhož textu je jen jeden blit
+         * a nealokuje žádnou paměť.
+         * @param   font        Font
+         * @param   text        Text v UTF-8
+         * @param   color       Barva textu
+         * @param   crop        Ořezový obdélník (v souřadnicích textu, viz
+         *  Effects::textSize) nebo NULL pro vykreslení celého textu
+         * @param   destination Surface, na kterou se vykresluje
+         * @param   position    Pozice textu
+         */
+        static void blitText(TTF_Font* font, const std::string& text, SDL_Color color, const SDL_Rect* crop, SDL_Surface* destination, const SDL_Rect* position);
+
+        /**
+         * @brief Uvolnění atlasu glyphů a cache textů
+         *
+         * Musí se zavolat před zavřením fontů, jejichž glyphy nebo texty jsou
+         * v cache (ukazatel na nový font může být stejný jako na zavřený).
+         * Při změně Effects::smoothText se cache textů uvolní sama.
+         */
+        static void clearTextCache(void);
+
+        /**
+         * @brief Velikost cache vyrenderovaných textů
+         *
+         * Velikost v kilobajtech, při překročení se uvolňují nejdéle
+         * nepoužité texty.
+         */
+        static unsigned int textCacheSize;
+
+        /** @brief Počet zásahů cache textů */
+        inline static unsigned int textCacheHits(void) { return _textCacheHits; }
+
+        /** @brief Počet výpadků cache textů */
+        inline static unsigned int textCacheMisses(void) { return _textCacheMisses; }
+
+        /** @brief Počet textů vyhozených z cache */
+        inline static unsigned int textCacheEvictions(void) { return _textCacheEvictions; }
+
+    private:
+        /** @brief Klíč glyphu v atlasu */
+        struct GlyphKey {
+            TTF_Font* font;         /**< @brief Font */
+            Uint32 color;           /**< @brief Barva (RGB) */
+            bool smooth;            /**< @brief Zda je glyph vyhlazený */
+            Uint16 character;       /**< @brief Znak (UCS-2) */
+
+            /** @brief Porovnání pro použití v std::map */
+            bool operator<(const GlyphKey& other) const;
+        };
+
+        /** @brief Glyph v atlasu */
+        struct Glyph {
+            SDL_Surface* page;      /**< @brief Stránka atlasu (NULL u prázdného glyphu) */
+            SDL_Rect area;          /**< @brief Oblast glyphu ve stránce */
+            int x,                  /**< @brief X-ové posunutí glyphu vůči pozici pera */
+                y,                  /**< @brief Y-ové posunutí glyphu vůči hornímu okraji textu */
+                advance;            /**< @brief Posun pera za glyphem */
+        };
+
+        /** @brief Metriky glyphu */
+        struct GlyphMetrics {
+            int minx,               /**< @brief Levý okraj glyphu vůči pozici pera */
+                maxx,               /**< @brief Pravý okraj glyphu vůči pozici pera */
+                advance;            /**< @brief Posun pera za glyphem */
+        };
+
+        /**
+         * @brief Klíč textu v cache
+         *
+         * Text se porovnává podle obsahu, při hledání ukazuje na hledaný
+         * řetězec (aby se nemusel kopírovat), v indexu na řetězec uložený v
+         * Effects::CachedText.
+         */
+        struct TextKey {
+            TTF_Font* font;         /**< @brief Font */
+            Uint32 color;           /**< @brief Barva (RGB) */
+            const std::string* text;    /**< @brief Text */
+
+            /** @brief Porovnání pro použití v std::map */
+            bool operator<(const TextKey& other) const;
+        };
+
+        /** @brief Text v cache */
+        struct CachedText {
+            std::string text;       /**< @brief Text */
+            TextKey key;            /**< @brief Klíč v indexu */
+            SDL_Surface* surface;   /**< @brief Vyrenderovaný text */
+        };
+
+        /** @brief Velikost stránky atlasu */
+        static const int atlasPageSize = 256;
+
+        static std::map<GlyphKey, Glyph> glyphs;    /**< @brief Glyphy v atlasu */
+        static std::map<GlyphKey, GlyphMetrics> metrics;    /**< @brief Metriky znaků (bez barvy a vyhlazení) */
+        static std::map<GlyphKey, int> kerning;     /**< @brief Vyrovnání párů znaků (color je první znak, character druhý) */
+        static std::vector<SDL_Surface*> atlasPages;    /**< @brief Stránky atlasu */
+        static std::list<CachedText> texts;     /**< @brief Texty v cache, naposledy použité na začátku */
+        static std::map<TextKey, std::list<CachedText>::iterator> textIndex;    /**< @brief Index textů v cache */
+        static bool textCacheSmoothText;        /**< @brief Vyhlazení, se kterým jsou vyrenderované texty v cache */
+        static unsigned int textCacheUsed,      /**< @brief Velikost textů v cache v bajtech */
+                            _textCacheHits,     /**< @brief Počet zásahů cache textů */
+                            _textCacheMisses,   /**< @brief Počet výpadků cache textů */
+                            _textCacheEvictions;    /**< @brief Počet textů vyhozených z cache */
+
+        static int atlasX,                          /**< @brief X-ová pozice pro další glyph v poslední stránce */
+                   atlasY,                          /**< @brief Y-ová pozice aktuální police v poslední stránce */
+                   atlasShelfHeight;                /**< @brief Výška aktuální police v poslední stránce */
+
+        /**
+         * @brief Glyph z atlasu
+         *
+         * Pokud glyph v atlasu ještě není, vyrenderuje ho a uloží.
+         */
+        static const Glyph& glyph(TTF_Font* font, SDL_Color color, Uint16 character);
+
+        /**
+         * @brief Vykreslení textu po glyphech
+         *
+         * Parametry stejné jako u Effects::blitText.
+         * @param   copyAlpha   Zda kopírovat glyphy i s průhledností (při
+         *  skládání textu do surface s alfa kanálem)
+         */
+        static void blitGlyphs(TTF_Font* font, const std::string& text, SDL_Color color, const SDL_Rect* crop, SDL_Surface* destination, const SDL_Rect* position, bool copyAlpha = false);
+
+        /**
+         * @brief Text z cache
+         *
+         * Pokud text v cache ještě není, složí ho z glyphů a uloží.
+         * @return Vyrenderovaný text nebo NULL u prázdného textu
+         */
+        static SDL_Surface* cachedText(TTF_Font* font, const std::string& text, SDL_Color color);
+
+        /** @brief Velikost vyrenderovaného textu v bajtech */
+        inline static unsigned int textSurfaceSize(const SDL_Surface* surface) {
+            return sizeof(SDL_Surface) + (*surface).pitch*(*surface).h;
+        }
+
+        /** @brief Metriky znaku */
+        static const GlyphMetrics& glyphMetrics(TTF_Font* font, Uint16 character);
+
+        /**
+         * @brief Rozměry a levý okraj textu
+         *
+         * @param   font        Font
+         * @param   text        Text
+         * @param   left        Levý okraj prvního glyphu vůči počátku pera
+         *  (záporný, pokud glyph přesahuje doleva, jinak 0)
+         * @param   w           Šířka textu včetně přesahů glyphů
+         * @param   h           Výška textu
+         */
+        static void textBounds(TTF_Font* font, const std::string& text, int& left, int& w, int& h);
+
+        /**
+         * @brief Zkopírování glyphu do surface s alfa kanálem
+         *
+         * Pixel se zkopíruje, jen pokud je méně průhledný než pixel v cíli,
+         * takže se překrývající glyphy (vyrovnání, kurzíva) nepřepisují
+         * průhlednými okraji. Obě surface musí být 32bitové s alfou v
+         * nejvyšším bajtu.
+         */
+        static void copyGlyph(SDL_Surface* page, const SDL_Rect& area, SDL_Surface* destination, int x, int y);
+
+        /** @brief Vyrovnání mezi dvěma znaky */
+        static int kerningSize(TTF_Font* font, Uint16 previous, Uint16 character);
+
+        /**
+         * @brief Další znak UTF-8 řetězce
+         *
+         * @param   text        Text
+         * @param   position    Pozice znaku, posune se na další znak
+         * @return  Znak v UCS-2 (znaky mimo BMP a neplatné sekvence jsou
+         *  nahrazeny otazníkem)
+         */
+        static Uint16 nextCharacter(const std::string& text, std::string::size_type& position);
 };
 
 }}
@@ -21,22 +21,95 @@ namespace Kompas { namespace Sdl {
 unsigned int FPS::limit = 100;
 unsigned int FPS::lastFrameTime = 10;
 unsigned int FPS::timer = 0;
+unsigned int FPS::scheduleStart = 0;
+unsigned int FPS::scheduledFrames = 0;
+unsigned int FPS::scheduleLimit = 0;
+unsigned int FPS::histogram[FPS::histogramSize];
+unsigned int FPS::frames = 0;
+unsigned int FPS::missed = 0;
+unsigned int FPS::maxTime = 0;
 
 /* Refresh FPS */
 double FPS::refresh (void) {
-    unsigned int frameTime = SDL_GetTicks() - timer;
+    unsigned int now = SDL_GetTicks();
 
-    /* Můžem si dát pauzu, pokud máme limit */
-    if(limit != 0 && frameTime < 1000/limit)
-        SDL_Delay(1000/limit-frameTime);
+    /* Při změně limitu plánování od začátku */
+    if(limit != scheduleLimit) {
+        scheduleStart = now;
+        scheduledFrames = 0;
+        scheduleLimit = limit;
+    }
+
+    /* Můžem si dát pauzu do termínu konce snímku, pokud máme limit */
+    if(limit != 0) {
+        unsigned int deadline = scheduleStart + (++scheduledFrames)*1000/limit;
+
+        if(now < deadline) SDL_Delay(deadline-now);
+        else {
+            if(now > deadline) ++missed;
+
+            /* Zpoždění o víc než snímek, nedohánění */
+            if(now-deadline >= 1000/limit) {
+                scheduleStart = now;
+                scheduledFrames = 0;
+            }
+        }
+    }
 
     /* Aktualizace hodnot */
     lastFrameTime = SDL_GetTicks() - timer;
     timer = SDL_GetTicks();
 
+    /* Záznam do histogramu */
+    ++histogram[lastFrameTime < histogramSize ? lastFrameTime : histogramSize-1];
+    ++frames;
+    if(lastFrameTime > maxTime) maxTime = lastFrameTime;
+
     return ((double) 1000)/((double) lastFrameTime);
 }
 
+/* Uspání do další události */
+bool FPS::wait(int timeout) {
+    unsigned int start = SDL_GetTicks();
+    bool event = true;
+
+    while(!SDL_PollEvent(NULL)) {
+        if(timeout >= 0 && SDL_GetTicks()-start >= (unsigned int) timeout) {
+            event = false;
+            break;
+        }
+
+        SDL_Delay(waitInterval);
+    }
+
+    /* Spánek se do času snímku nepočítá, ani se kvůli němu neposouvají
+       termíny dalších snímků */
+    timer += SDL_GetTicks()-start;
+    scheduleStart += SDL_GetTicks()-start;
+    return event;
+}
+
+/* Percentil času snímku */
+unsigned int FPS::percentile(unsigned int percent) {
+    if(frames == 0) return 0;
+
+    /* Počet snímků, které musí být pod hledaným časem (zaokrouhleno nahoru) */
+    unsigned int count = (frames*percent+99)/100;
+    if(count == 0) count = 1;
+
+    unsigned int sum = 0;
+    for(unsigned int i = 0; i != histogramSize-1; ++i)
+        if((sum += histogram[i]) >= count) return i;
+
+    return maxTime;
+}
+
+/* Vynulování statistik */
+void FPS::resetStatistics(void) {
+    for(unsigned int i = 0; i != histogramSize; ++i) histogram[i] = 0;
+    frames = missed = maxTime = 0;
+}
+
 /* Pohyb objektu */
 int FPS::move (unsigned int pps, FPS::Data* object) {
     /* Pokud je objekt ještě pozastaven, pohyb se nekoná */
@@ -69,20 +69,73 @@ class FPS {
          * členy, není nutné její instanci ukládat do proměnné.
          */
         FPS(void) {
-            timer = SDL_GetTicks();
+            timer = scheduleStart = SDL_GetTicks();
+            scheduledFrames = 0;
+            scheduleLimit = limit;
         }
 
         /**
          * @brief Refresh
          *
-         * Spouštět na konci každé smyčky programového cyklu. Pozastaví program,
-         * pokud byl čas vykonání smyčky kratší, než kolik dovoluje limit FPS a
-         * z celkového času smyčky umožní výpočet rychlosti pohybu objektů.
+         * Spouštět na konci každé smyčky programového cyklu. Pozastaví program
+         * do termínu konce snímku a z celkového času smyčky umožní výpočet
+         * rychlosti pohybu objektů. Termíny jsou počítány absolutně od
+         * začátku plánování (n-tý snímek končí v čase začátek + n*1000/limit),
+         * takže se zaokrouhlení ani nepřesnost SDL_Delay() nesčítají. Pokud
+         * snímek termín nestihne, započítá se jako zmeškaný a pokud je
+         * zpoždění větší než celý snímek, plánování začne znovu od
+         * aktuálního času, aby se následující snímky nesnažily ztrátu
+         * dohnat. Čas snímku se zaznamená do histogramu.
          * @note Může být inline, protože je volaná jen na jednom místě v kódu.
          * @return %FPS aktuálního snímku
          */
         static double refresh(void);
 
+        /**
+         * @brief Uspání do další události
+         *
+         * Volat na začátku smyčky, pokud se nic nemění (nic není poškozené,
+         * nic se nepohybuje ani nenačítá). Vrátí se, jakmile je ve frontě
+         * nějaká událost (ta ve frontě zůstane) nebo vyprší časový limit.
+         * Doba spánku se nezapočítá do času snímku, takže FPS::move po
+         * probuzení neudělá skok. SDL 1.2 nemá SDL_WaitEventTimeout() a
+         * SDL_WaitEvent() sám kontroluje frontu každých 10 ms, tady se to
+         * dělá stejně.
+         * @param   timeout Časový limit v milisekundách, záporná hodnota
+         *  znamená čekání bez limitu
+         * @return  Zda přišla událost (false při vypršení limitu)
+         */
+        static bool wait(int timeout = -1);
+
+        /**
+         * @brief Čas zpracování posledního snímku
+         *
+         * @return Čas v milisekundách
+         */
+        inline static unsigned int frameTime(void) { return lastFrameTime; }
+
+        /** @brief Počet snímků zaznamenaných v histogramu */
+        inline static unsigned int frameCount(void) { return frames; }
+
+        /** @brief Počet snímků, které nestihly svůj termín */
+        inline static unsigned int missedDeadlines(void) { return missed; }
+
+        /** @brief Nejdelší čas snímku v milisekundách */
+        inline static unsigned int maxFrameTime(void) { return maxTime; }
+
+        /**
+         * @brief Percentil času snímku
+         *
+         * @param   percent Percentil (např. 50, 95, 99)
+         * @return  Čas v milisekundách, pod který (včetně) spadá dané
+         *  procento snímků. Časy delší než FPS::histogramSize-1 ms jsou
+         *  v histogramu sloučeny, pro ně vrací FPS::maxFrameTime.
+         */
+        static unsigned int percentile(unsigned int percent);
+
+        /** @brief Vynulování histogramu a statistik */
+        static void resetStatistics(void);
+
         /**
          * @brief Spočítání délky posunu v aktuálním snímku
          *
@@ -121,6 +174,19 @@ class FPS {
     private:
         static unsigned int timer;          /**< @brief Čas při konci posledního snímku */
         static unsigned int lastFrameTime;  /**< @brief Čas zpracování posledního snímku */
+        static const unsigned int waitInterval = 10; /**< @brief Interval kontroly fronty událostí při spánku */
+
+        static unsigned int scheduleStart;  /**< @brief Čas začátku plánování snímků */
+        static unsigned int scheduledFrames; /**< @brief Počet snímků od začátku plánování */
+        static unsigned int scheduleLimit;  /**< @brief Limit FPS, se kterým se plánovalo */
+
+        /** @brief Velikost histogramu (po jedné milisekundě) */
+        static const unsigned int histogramSize = 256;
+
+        static unsigned int histogram[histogramSize]; /**< @brief Histogram časů snímků */
+        static unsigned int frames;         /**< @brief Počet zaznamenaných snímků */
+        static unsigned int missed;         /**< @brief Počet zmeškaných termínů */
+        static unsigned int maxTime;        /**< @brief Nejdelší čas snímku */
 };
 
 }}
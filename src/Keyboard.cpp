@@ -18,6 +18,7 @@
 #include <iostream>
 #include <sstream>
 
+#include "Compositor.h"
 #include "ConfParser.h"
 #include "Effects.h"
 #include "Skin.h"
@@ -34,7 +35,7 @@ template class Matrix<KeyboardKey>;
 #endif
 
 /* Konstruktor */
-Keyboard::Keyboard(SDL_Surface* _screen, Skin& _skin, std::string file, std::string& _text, int _flags): screen(_screen), skin(_skin), text(_text), cursor(text.end()), cursorBlink(0), flags(_flags), shiftPushed(false) {
+Keyboard::Keyboard(SDL_Surface* _screen, Skin& _skin, std::string file, std::string& _text, int _flags): screen(_screen), skin(_skin), text(_text), cursor(text.end()), cursorBlink(0), flags(_flags), shiftPushed(false), layoutGeneration(0) {
     /* Otevření conf souboru */
     ConfParser keyboard(file);
 
@@ -290,21 +291,27 @@ bool Keyboard::click(int x, int y, int& action) {
     /* Klávesnice je schovaná, konec */
     if(flags & HIDDEN) return false;
 
-    /* Oblast klávesnice */
-    SDL_Rect area = Effects::align(screen, *align, keyboardW, keyboardH, *keyboardX, *keyboardY);
-
+    updateLayout();
     if(!inArea(x, y, area)) return false;
 
-    /* Procházení jednotlivých kláves */
-    for(vector<KeyboardKey>::const_iterator it = items.begin(); it != items.end(); it++) {
-        /* Nalezeno */
-        if(!((*it).flags & DISABLED) && inArea(x, y, Effects::align(area, ALIGN_DEFAULT, (*it).position))) {
-            actualItem = it;
-            select();
-            return true;
+    /* Sestavení indexu kláves z rozvržení, pokud se změnilo */
+    if(hitTestOutdated(area)) {
+        clearHitTargets(area);
+        for(vector<SDL_Rect>::const_iterator it = keyAreas.begin(); it != keyAreas.end(); ++it) {
+            SDL_Rect keyArea = *it;
+            keyArea.x -= area.x; keyArea.y -= area.y;
+            addHitTarget(keyArea, it-keyAreas.begin());
         }
     }
 
+    /* Nalezení klávesy */
+    int key = hitTest(area, x, y);
+    if(key != -1) {
+        actualItem = items.begin()+key;
+        damage();
+        select();
+    }
+
     return true;
 }
 
@@ -386,6 +393,52 @@ void Keyboard::select(void) {
         specialPushed = items.end();
         specialShiftPushed = items.end();
     }
+
+    damage();
+}
+
+/* Aktualizace klávesnice */
+void Keyboard::update(void) {
+    /* Pokud nadešel čas, přepnutí kurzoru a nastavení dalšího času */
+    if(!FPS::paused(cursorBlink)) {
+        (flags & SHOW_CURSOR) ? flags &= ~SHOW_CURSOR : flags |= SHOW_CURSOR;
+        FPS::pause(*cursorInterval, cursorBlink);
+        if(!(flags & HIDDEN)) damage();
+    }
+}
+
+/* Čas do další změny */
+int Keyboard::nextUpdate(void) const {
+    if(flags & HIDDEN) return -1;
+    if(!FPS::paused(cursorBlink)) return 0;
+
+    return (unsigned int) (0-cursorBlink)-SDL_GetTicks();
+}
+
+/* Poškození oblasti klávesnice */
+void Keyboard::damage(void) {
+    updateLayout();
+    Compositor::damage(area);
+}
+
+/* Oblast klávesnice */
+SDL_Rect Keyboard::bounds(void) {
+    updateLayout();
+    return area;
+}
+
+/* Aktualizace rozvržení */
+void Keyboard::updateLayout(void) {
+    if(layoutGeneration == Compositor::layoutGeneration()) return;
+    layoutGeneration = Compositor::layoutGeneration();
+    invalidateHitTest();
+
+    area = Effects::align(screen, *align, keyboardW, keyboardH, *keyboardX, *keyboardY);
+    textArea = Effects::align(area, ALIGN_DEFAULT, textPosition);
+
+    keyAreas.clear();
+    for(vector<KeyboardKey>::const_iterator it = items.begin(); it != items.end(); ++it)
+        keyAreas.push_back(Effects::align(area, ALIGN_DEFAULT, (*it).position));
 }
 
 /* Zobrazení klávesnice */
@@ -393,27 +446,28 @@ void Keyboard::view(void) {
     /* Klávesnice je schovaná, konec */
     if(flags & HIDDEN) return;
 
-    /* Plocha pro vykreslování klávesnice */
-    SDL_Rect area = Effects::align(screen, *align, keyboardW, keyboardH, *keyboardX, *keyboardY);
+    /* Předpočítané rozvržení */
+    updateLayout();
 
-    /* Pozadí */
-    SDL_BlitSurface(*image, NULL, screen, &area);
+    /* Pozadí (SDL_BlitSurface mění cílový obdélník při ořezu) */
+    SDL_Rect imageArea = area;
+    SDL_BlitSurface(*image, NULL, screen, &imageArea);
 
-    SDL_Rect _textPosition = Effects::align(area, ALIGN_DEFAULT, textPosition);
+    SDL_Rect _textPosition = textArea;
 
     /* Pokud je nějaký editovaný text */
     if(!text.empty()) {
-        SDL_Surface* _text = (*Effects::textRenderFunction())(*textFont, text.c_str(), *textColor);
+        int textW, textH;
+        Effects::textSize(*textFont, text, textW, textH);
 
-        _textPosition = Effects::align(_textPosition, textAlign, (*_text).w, (*_text).h);
+        _textPosition = Effects::align(_textPosition, textAlign, textW, textH);
         /** @todo Ořezy tak, aby bylo vidět co píšu */
         SDL_Rect textCrop = {0, 0, _textPosition.w, _textPosition.h};
-        SDL_BlitSurface(_text, &textCrop, screen, &_textPosition);
-        SDL_FreeSurface(_text);
+        Effects::blitText(*textFont, text, *textColor, &textCrop, screen, &_textPosition);
 
         /* Zjištění pozice kurzoru v textu */
         string textBeforeCursor(text.begin(), cursor);
-        int w, h; TTF_SizeUTF8(*textFont, textBeforeCursor.c_str(), &w, &h);
+        int w, h; Effects::textSize(*textFont, textBeforeCursor, w, h);
 
         /* Z kurzoru jen vertikální zarovnání, horizontálně se řadí nalevo */
         _textPosition.x += w;
@@ -427,12 +481,6 @@ void Keyboard::view(void) {
             (**cursorImage).w, (**cursorImage).h, *cursorX, *cursorY);
     }
 
-    /* Pokud nadešel čas, přepnutí kurzoru a nastavení dalšího času */
-    if(!FPS::paused(cursorBlink)) {
-        (flags & SHOW_CURSOR) ? flags &= ~SHOW_CURSOR : flags |= SHOW_CURSOR;
-        FPS::pause(*cursorInterval, cursorBlink);
-    }
-
     /* Vykreslení kurzoru */
     if(flags & SHOW_CURSOR) {
         SDL_Rect cursorCrop = {0, 0, _textPosition.w, _textPosition.h};
@@ -442,16 +490,17 @@ void Keyboard::view(void) {
     /* Jednotlivé klávesy */
     for(vector<KeyboardKey>::const_iterator it = items.begin(); it != items.end(); ++it) {
         /* Plocha pro klávesu */
-        SDL_Rect keyArea = Effects::align(area, ALIGN_DEFAULT, (*it).position);
+        const SDL_Rect& keyArea = keyAreas[it-items.begin()];
 
         /* Pozadí */
         SDL_Surface* image = *(*it).image;
         if(it == actualItem) image = *(*it).activeImage;
-        SDL_BlitSurface(image, NULL, screen, &keyArea);
+        SDL_Rect imageArea = keyArea;
+        SDL_BlitSurface(image, NULL, screen, &imageArea);
 
         /* Popisek - Pokud je nastaveno jméno klávesy, bude vypsáno vždy */
-        string label;
-        if(!(*it).name.empty()) label = (*it).name;
+        const string* label;
+        if(!(*it).name.empty()) label = &(*it).name;
 
         /* Jinak se vypisuje podle toho, jaké modifikátory jsou aktivní a jestli existuje nějaká hodnota */
         else {
@@ -466,11 +515,11 @@ void Keyboard::view(void) {
             /* Shift */
             if(shiftPushed) valuePosition++;
 
-            label = (*it).values[valuePosition];
+            label = &(*it).values[valuePosition];
         }
 
         /* Pokud je vůbec nějaký popisek */
-        if(!label.empty()) {
+        if(!(*label).empty()) {
             /* Barva popisku */
             SDL_Color color;
 
@@ -485,12 +534,12 @@ void Keyboard::view(void) {
             /* Běžná klávesa */
             else color = *keyColor;
 
-            SDL_Surface* _text = (*Effects::textRenderFunction())(*keyFont, label.c_str(), color);
+            int textW, textH;
+            Effects::textSize(*keyFont, *label, textW, textH);
 
-            SDL_Rect _textPosition = Effects::align(keyArea, *keyAlign, (*_text).w, (*_text).h);
+            SDL_Rect _textPosition = Effects::align(keyArea, *keyAlign, textW, textH);
             SDL_Rect _textCrop = {0, 0, _textPosition.w, _textPosition.h};
-            SDL_BlitSurface(_text, &_textCrop, screen, &_textPosition);
-            SDL_FreeSurface(_text);
+            Effects::blitText(*keyFont, *label, color, &_textCrop, screen, &_textPosition);
         }
     }
 }
@@ -28,6 +28,7 @@
 #include "FPS.h"
 #include "Matrix.h"
 #include "Mouse.h"
+#include "Scene.h"
 #include "utility.h"
 
 namespace Kompas { namespace Sdl {
@@ -77,7 +78,7 @@ struct KeyboardKey {
  * @todo Propojení klávesnice a skinu!
  * @todo Duplicitní ConfParser <=> Skin
  */
-class Keyboard: public Matrix<KeyboardKey>, public Mouse {
+class Keyboard: public Matrix<KeyboardKey>, public Mouse, public SceneNode {
     public:
         /** @brief Flags */
         enum Flags {
@@ -129,16 +130,46 @@ class Keyboard: public Matrix<KeyboardKey>, public Mouse {
         bool click(int x, int y, int& action);
 
         /** @brief Schování toolbaru */
-        inline void hide(void) { flags |= HIDDEN; }
+        inline void hide(void) { flags |= HIDDEN; damage(); }
 
         /** @brief Povolení zobrazení toolbaru */
-        inline void show(void) { flags &= ~HIDDEN; }
+        inline void show(void) { flags &= ~HIDDEN; damage(); }
 
         /** @brief Zjištění, jestli je povoleno zobrazení toolbaru */
         inline operator bool(void) { return !(flags & HIDDEN); }
 
+        /**
+         * @brief Aktualizace stavu klávesnice
+         *
+         * Přepíná blikající kurzor. Volat jednou za snímek, nezávisle na
+         * vykreslování.
+         */
+        void update(void);
+
+        /**
+         * @brief Čas do další změny klávesnice
+         *
+         * @return  Počet milisekund do dalšího přebliknutí kurzoru, -1, pokud
+         *  je klávesnice schovaná
+         */
+        int nextUpdate(void) const;
+
         /** @brief Zobrazení klávesnice */
         void view(void);
+
+        /** @brief Oblast klávesnice */
+        SDL_Rect bounds(void);
+
+        /** @brief Zda není klávesnice schovaná */
+        inline bool isVisible(void) const { return !(flags & HIDDEN); }
+
+    protected:
+        /** @brief Nahlášení oblasti klávesnice jako poškozené */
+        void damage(void);
+
+        /** @brief Na zakázané klávesy nelze kliknout */
+        inline bool hitTargetEnabled(int id) const { return !(items[id].flags & DISABLED); }
+
     private:
         /**
          * @brief Flags klávesy
@@ -206,6 +237,19 @@ class Keyboard: public Matrix<KeyboardKey>, public Mouse {
 
         /** @brief Zda byl stlačen Shift */
         bool shiftPushed;
+
+        unsigned int layoutGeneration;  /**< @brief Generace rozvržení (0, pokud je potřeba přepočítat) */
+        SDL_Rect area;          /**< @brief Oblast klávesnice */
+        SDL_Rect textArea;      /**< @brief Oblast zpracovávaného textu */
+        std::vector<SDL_Rect> keyAreas; /**< @brief Oblasti kláves */
+
+        /**
+         * @brief Aktualizace rozvržení
+         *
+         * Přepočítá oblasti klávesnice, textu a kláves, pokud se změnila
+         * generace rozvržení (viz Compositor::layoutGeneration).
+         */
+        void updateLayout(void);
 };
 
 /**
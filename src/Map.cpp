@@ -15,10 +15,15 @@
 
 #include "Map.h"
 
-#include <iostream>
+#include <algorithm>    /* min(), max() */
+#include <cstdlib>      /* abs() */
 #include <sstream>
 
+#include "Compositor.h"
 #include "Effects.h"
+#include "TileCache.h"
+#include "TileLoader.h"
+#include "TilePackage.h"
 #include "utility.h"
 
 using namespace std;
@@ -26,14 +31,60 @@ using namespace std;
 namespace Kompas { namespace Sdl {
 
 /* Konstruktor */
-Map::Map(SDL_Surface* _screen, SDL_Surface** _tileLoading, SDL_Surface** _tileNotFound):
+Map::Map(SDL_Surface* _screen, SDL_Surface** _tileLoading, SDL_Surface** _tileNotFound, int* _tileCacheSize, int* _prefetchDepth, const std::string& tileDirectory, unsigned int _loaderThreads):
 screen(_screen), tileLoading(_tileLoading), tileNotFound(_tileNotFound), tileW(256),
-tileH(256), tileMatrixW(0), tileMatrixH(0), beginX(0), beginY(0), endX(0xFFFFFFFF),
-endY(0xFFFFFFFF), moveX(0), moveY(0) {
+tileH(256), tileMatrixW(0), tileMatrixH(0), tileCapacityW(0), tileCapacityH(0),
+originCol(0), originRow(0), zoom(0), tileX(100), tileY(100), loaderThreads(_loaderThreads),
+package(NULL), beginX(0), beginY(0),
+endX(0xFFFFFFFF), endY(0xFFFFFFFF), moveX(0), moveY(0), prefetchDepth(_prefetchDepth),
+lastTileX(tileX), lastTileY(tileY), lastMoveX(0), lastMoveY(0), velocityX(0),
+velocityY(0), prefetchX(0), prefetchY(0), _tileLabels(true), labelFont(NULL),
+labelSmoothText(Effects::smoothText), labelFontSource(NULL), labelColorSource(NULL),
+_prefetchRequests(0), _prefetchHits(0) {
+    labelColor.r = labelColor.g = labelColor.b = 0;
+
+    loader = new TileLoader(*(*screen).format, tileDirectory, loaderThreads);
+    cache = new TileCache(_tileCacheSize);
+
     resizeMatrix();
     loadTiles();
 }
 
+/* Destruktor */
+Map::~Map(void) {
+    releaseTiles(0, 0, tileMatrixW, tileMatrixH);
+
+    /* Nevyzvednuté dlaždice uvolní TileLoader sám */
+    delete loader;
+    delete cache;
+    delete package;
+}
+
+/* Otevření mapového balíčku */
+bool Map::open(const std::string& file) {
+    TilePackage* opened = new TilePackage(file);
+    if(!(*opened).isValid()) {
+        delete opened;
+        return false;
+    }
+
+    /* Zahození dlaždic z původního zdroje. Zrušení loaderu počká na
+       dokončení rozdělaných dlaždic, takže starý balíček lze pak zavřít. */
+    releaseTiles(0, 0, tileMatrixW, tileMatrixH);
+    delete loader;
+    (*cache).clear();
+    prefetched.clear();
+    delete package;
+
+    package = opened;
+    loader = new TileLoader(*(*screen).format, package, loaderThreads);
+
+    resetTiles(0, 0, tileMatrixW, tileMatrixH);
+    loadTiles();
+    Compositor::damage();
+    return true;
+}
+
 /* Změna velikosti matice */
 bool Map::resizeMatrix(void) {
     vector<Tile>::size_type oldTileMatrixW = tileMatrixW,
@@ -43,122 +94,245 @@ bool Map::resizeMatrix(void) {
 
     if(tileMatrixH == oldTileMatrixH && tileMatrixW == oldTileMatrixW) return false;
 
-    /* Rezervace kapacity pro zvětšení vektoru */
-    if(tileMatrixH*tileMatrixW > oldTileMatrixH*oldTileMatrixW)
-        tiles.reserve(tileMatrixH*tileMatrixW);
-
-    /* Pokud máme prázdno, normální naplnění */
-    if(tiles.empty()) {
-        for(vector<Tile>::size_type row = 0; row != tileMatrixH; ++row) {
-            for(vector<Tile>::size_type col = 0; col != tileMatrixW; ++col) {
-                Tile tile;
-                tile.x = 100+col;
-                tile.y = 100+row;
-                tile.isLoaded = false;
-                tiles.push_back(tile);
+    /* Zachované dlaždice (ty, které jsou v původní i nové matici) */
+    vector<Tile>::size_type keptW = min(oldTileMatrixW, tileMatrixW),
+                            keptH = min(oldTileMatrixH, tileMatrixH);
+
+    /* Uvolnění dlaždic, které se do nové matice nevejdou (sloupce vpravo,
+       řádky dole) */
+    releaseTiles(keptW, 0, oldTileMatrixW-keptW, oldTileMatrixH);
+    releaseTiles(0, keptH, keptW, oldTileMatrixH-keptH);
+
+    /* Matice se do bufferu nevejde, realokace. Zachované dlaždice se
+       přesunou tak, aby počátek nového bufferu byl na nule. */
+    if(tileMatrixW > tileCapacityW || tileMatrixH > tileCapacityH) {
+        vector<Tile>::size_type capacityW = max(tileMatrixW, tileCapacityW),
+                                capacityH = max(tileMatrixH, tileCapacityH);
+
+        vector<Tile> ring(capacityW*capacityH);
+        for(vector<Tile>::size_type row = 0; row != keptH; ++row)
+            for(vector<Tile>::size_type col = 0; col != keptW; ++col)
+                ring[row*capacityW+col] = tile(col, row);
+
+        tiles.swap(ring);
+        tileCapacityW = capacityW;
+        tileCapacityH = capacityH;
+        originCol = 0;
+        originRow = 0;
+    }
+
+    /* Doplnění chybějících sloupců vpravo (jen v zachovaných řádcích) */
+    if(tileMatrixW > oldTileMatrixW)
+        resetTiles(oldTileMatrixW, 0, tileMatrixW-oldTileMatrixW, keptH);
+
+    /* Doplnění chybějících řádků dole */
+    if(tileMatrixH > oldTileMatrixH)
+        resetTiles(0, oldTileMatrixH, tileMatrixW, tileMatrixH-oldTileMatrixH);
+
+    return true;
+}
+
+/* Uvolnění dlaždic */
+void Map::releaseTiles(vector<Tile>::size_type col, vector<Tile>::size_type row, vector<Tile>::size_type cols, vector<Tile>::size_type rows) {
+    for(vector<Tile>::size_type r = row; r != row+rows; ++r) {
+        for(vector<Tile>::size_type c = col; c != col+cols; ++c) {
+            Tile& t = tile(c, r);
+
+            /* Dlaždice odrolovala dřív, než se stihla načíst */
+            if(t.state == LOADING) {
+                TileCoordinates coordinates = {zoom, t.x, t.y};
+                (*loader).cancel(coordinates);
+            }
+
+            /* Načtená dlaždice se uloží pro případ, že se na ni vrátíme */
+            else if(t.state == LOADED) {
+                TileCoordinates coordinates = {zoom, t.x, t.y};
+                (*cache).put(coordinates, t.image);
             }
+
+            if(t.label != NULL) SDL_FreeSurface(t.label);
+
+            t.image = NULL;
+            t.label = NULL;
+            t.state = EMPTY;
         }
+    }
+}
 
-        cout << tiles.size() << endl;
+/* Uvolnění popisků dlaždic */
+void Map::releaseLabels(void) {
+    for(vector<Tile>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        if((*it).label == NULL) continue;
 
-        return true;
+        SDL_FreeSurface((*it).label);
+        (*it).label = NULL;
     }
+}
 
-    /* Přidávání chybějících sloupců doprava (zatím zachováváme starou výšku) */
-    if(oldTileMatrixW < tileMatrixW) {
-        for(vector<Tile>::size_type row = 0; row != oldTileMatrixH; ++row) {
-            for(vector<Tile>::size_type col = oldTileMatrixW; col != tileMatrixW; ++col) {
-                /* Pozice: všechny řádky nad tímto již mají plný počet položek,
-                   proto se násobí novým (větším) počtem položek */
-                vector<Tile>::iterator position = tiles.begin()+row*tileMatrixW+col;
-
-                /* Zjištění souřadnic z dlaždice vlevo od aktuální */
-                Tile tile;
-                tile.x = (*(position-1)).x+1;
-                tile.y = (*(position-1)).y;
-                tile.isLoaded = false;
-
-                /* Přidáváme PŘED pozici */
-                tiles.insert(position, tile);
-            }
-        }
+/* Zapnutí / vypnutí popisků dlaždic */
+void Map::setTileLabels(bool enabled) {
+    _tileLabels = enabled;
+    Compositor::damage();
+    if(!enabled) releaseLabels();
+}
+
+/* Nastavení souřadnic dlaždic */
+void Map::resetTiles(vector<Tile>::size_type col, vector<Tile>::size_type row, vector<Tile>::size_type cols, vector<Tile>::size_type rows) {
+    releaseTiles(col, row, cols, rows);
 
-    /* Odebírání přebývajících sloupců zprava (pokud nějaké přebývají) */
-    } else if(oldTileMatrixW != tileMatrixW) {
-        for(vector<Tile>::size_type row = 0; row != oldTileMatrixH; ++row) {
-            /* Ve všech předchozích řádcích jsou již odstraněny sloupce, proto
-               je pozice počítána z nové šířky řádku */
-            tiles.erase(tiles.begin()+row*tileMatrixW+tileMatrixW,
-                        tiles.begin()+row*tileMatrixW+oldTileMatrixW);
+    for(vector<Tile>::size_type r = row; r != row+rows; ++r) {
+        for(vector<Tile>::size_type c = col; c != col+cols; ++c) {
+            Tile& t = tile(c, r);
+            t.x = tileX+c;
+            t.y = tileY+r;
         }
     }
+}
 
-    /* Přidávání chybějících řádků dolů */
-    if(oldTileMatrixH < tileMatrixH) {
-        /* Počáteční pozice matice */
-        unsigned int x = tiles.front().x,
-                     y = tiles.front().y;
-
-        for(vector<Tile>::size_type row = oldTileMatrixH; row != tileMatrixH; ++row) {
-            for(vector<Tile>::size_type col = 0; col != tileMatrixW; ++col) {
-                Tile tile;
-                tile.x = x+col;
-                tile.y = y+row;
-                tile.isLoaded = false;
-                tiles.push_back(tile);
+/* Načtení dlaždic */
+void Map::loadTiles(vector<Tile>::size_type col, vector<Tile>::size_type row, vector<Tile>::size_type cols, vector<Tile>::size_type rows) {
+    for(vector<Tile>::size_type r = row; r != row+rows; ++r) {
+        for(vector<Tile>::size_type c = col; c != col+cols; ++c) {
+            Tile& t = tile(c, r);
+            if(t.state != EMPTY) continue;
+
+            TileCoordinates coordinates = {zoom, t.x, t.y};
+
+            /* Dlaždice je v cache, není co načítat */
+            if((t.image = (*cache).take(coordinates)) != NULL) {
+                t.state = LOADED;
+                if(prefetched.erase(coordinates)) ++_prefetchHits;
+                continue;
             }
+
+            /* Předem zažádaná dlaždice se ještě nenačetla, request() jí
+               zvýší prioritu */
+            prefetched.erase(coordinates);
+
+            (*loader).request(coordinates);
+            t.state = LOADING;
+        }
+    }
+}
+
+/* Převzetí načtených dlaždic */
+void Map::collectTiles(void) {
+    TileLoader::Tile loaded;
+    while((*loader).finished(loaded)) {
+        /* Dlaždice mezitím z matice odrolovala nebo se změnilo přiblížení,
+           uložení do cache pro případ, že se na ni vrátíme */
+        if(loaded.coordinates.zoom != zoom ||
+           loaded.coordinates.x < tileX || loaded.coordinates.x >= tileX+tileMatrixW ||
+           loaded.coordinates.y < tileY || loaded.coordinates.y >= tileY+tileMatrixH) {
+            if(loaded.image != NULL) (*cache).put(loaded.coordinates, loaded.image);
+            continue;
         }
 
-    /* Odstranění přebývajícíh řádků dole */
-    } else if(oldTileMatrixH != tileMatrixH)
-        tiles.erase(tiles.begin()+tileMatrixW*tileMatrixH, tiles.end());
+        Tile& t = tile(loaded.coordinates.x-tileX, loaded.coordinates.y-tileY);
 
-    /* Kontrola, jestli je vše ok */
-    /** @todo Po debugu tohle smazat! */
-    if(tileMatrixH*tileMatrixW != tiles.size())
-        cerr << "Chyba: množství dlaždic je " << tiles.size() << " místo očekávaných "
-             << tileMatrixW << "x" << tileMatrixH << "!" << endl;
+        /* Na dlaždici se už nečeká (nemělo by nastat, zrušené požadavky
+           TileLoader nevrací) */
+        if(t.state != LOADING) {
+            if(loaded.image != NULL) SDL_FreeSurface(loaded.image);
+            continue;
+        }
 
-    cout << tiles.size() << endl;
+        t.image = loaded.image;
+        t.state = loaded.image != NULL ? LOADED : NOT_FOUND;
 
-    return true;
+        /* Překreslení dlaždice */
+        SDL_Rect area = {
+            (int) ((loaded.coordinates.x-tileX)*tileW)-(int) moveX,
+            (int) ((loaded.coordinates.y-tileY)*tileH)-(int) moveY,
+            tileW, tileH};
+        Compositor::damage(area);
+    }
 }
 
-/* Načtení dlaždic */
-void Map::loadTiles(void) {
-    for(vector<Tile>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
-        if(!(*it).isLoaded) {
-            /** @todo A co takhle freeSurface? */
-            (*it).image = tileNotFound;
-            (*it).isLoaded = true;
-        }
+/* Výpočet rychlosti posunu */
+void Map::updateVelocity(void) {
+    int deltaX = (int) (tileX-lastTileX)*(int) tileW + (int) moveX-(int) lastMoveX,
+        deltaY = (int) (tileY-lastTileY)*(int) tileH + (int) moveY-(int) lastMoveY;
+    lastTileX = tileX; lastTileY = tileY;
+    lastMoveX = moveX; lastMoveY = moveY;
+
+    /* Okamžitá rychlost se průměruje s předchozí, aby jednotlivé snímky
+       bez posunu (např. mezi stisky kláves) hned nezrušily směr */
+    unsigned int frameTime = max(FPS::frameTime(), 1u);
+    velocityX = (velocityX + deltaX*1000/(int) frameTime)/2;
+    velocityY = (velocityY + deltaY*1000/(int) frameTime)/2;
+}
+
+/* Předem načtení dlaždic ve směru posunu */
+void Map::prefetchTiles(void) {
+    /* Minimální rychlost, od které se předem načítá (pixely za sekundu) */
+    const int minVelocity = 32;
+
+    int directionX = velocityX >= minVelocity ? 1 : (velocityX <= -minVelocity ? -1 : 0),
+        directionY = velocityY >= minVelocity ? 1 : (velocityY <= -minVelocity ? -1 : 0);
+    if(*prefetchDepth <= 0) directionX = directionY = 0;
+
+    /* Změna směru, zrušení nevyřízených požadavků. Už načtené dlaždice
+       zůstanou v cache. */
+    if((prefetchX != 0 && directionX != prefetchX) || (prefetchY != 0 && directionY != prefetchY)) {
+        for(set<TileCoordinates>::const_iterator it = prefetched.begin(); it != prefetched.end(); ++it)
+            (*loader).cancel(*it);
+        prefetched.clear();
     }
+    prefetchX = directionX;
+    prefetchY = directionY;
+
+    /* Počet řad podle vzdálenosti, kterou mapa urazí za sekundu */
+    unsigned int depthX = min((unsigned int) *prefetchDepth, 1+(unsigned int) abs(velocityX)/tileW),
+                 depthY = min((unsigned int) *prefetchDepth, 1+(unsigned int) abs(velocityY)/tileH);
+
+    if(directionX != 0) for(unsigned int d = 1; d <= depthX; ++d) {
+        /* Sloupec vlevo / vpravo od matice, pokud je ještě v mapě */
+        if(directionX < 0 ? tileX < beginX+d : tileX+tileMatrixW+d > endX) break;
+        unsigned int x = directionX < 0 ? tileX-d : tileX+tileMatrixW-1+d;
+
+        for(unsigned int y = tileY; y != tileY+tileMatrixH; ++y)
+            prefetchTile(x, y);
+    }
+
+    if(directionY != 0) for(unsigned int d = 1; d <= depthY; ++d) {
+        /* Řádek nad / pod maticí, pokud je ještě v mapě */
+        if(directionY < 0 ? tileY < beginY+d : tileY+tileMatrixH+d > endY) break;
+        unsigned int y = directionY < 0 ? tileY-d : tileY+tileMatrixH-1+d;
+
+        for(unsigned int x = tileX; x != tileX+tileMatrixW; ++x)
+            prefetchTile(x, y);
+    }
+}
+
+/* Předem načtení jedné dlaždice */
+void Map::prefetchTile(unsigned int x, unsigned int y) {
+    TileCoordinates coordinates = {zoom, x, y};
+    if(prefetched.find(coordinates) != prefetched.end() || (*cache).contains(coordinates))
+        return;
+
+    (*loader).request(coordinates, TileLoader::LOW);
+    prefetched.insert(coordinates);
+    ++_prefetchRequests;
 }
 
 /* Posunutí mapy nahoru */
 void Map::moveUp(unsigned int pixels) {
+    Compositor::damage();
+
     /* Posun mimo načtenou oblast mapy = přidání dalšího řádku dlaždic nahoru */
     if(pixels > moveY) {
-        unsigned int x = tiles.front().x,
-                     y = tiles.front().y;
-
         /* Už jsme na hranici mapy */
-        if(y-- == beginY) { moveY = 0; return; }
-
-        /* Smazání posledního řádku dole */
-        tiles.erase(tiles.end()-tileMatrixW, tiles.end());
-
-        /* Naplnění nového řádku nahoře */
-        vector<Tile>::iterator insertPos = tiles.begin();
-        for(unsigned int pos = x; pos != x+tileMatrixW; ++pos) {
-            Tile tile;
-            tile.x = pos;
-            tile.y = y;
-            tile.isLoaded = false;
-            insertPos = ++tiles.insert(insertPos, tile);
-        }
+        if(tileY == beginY) { moveY = 0; return; }
 
-        loadTiles();
+        /* Uvolnění spodního řádku a posunutí počátku bufferu o řádek
+           nahoru (pokud je buffer větší než matice, spodní řádek se tím
+           nepřesune nahoru), stačí pak jen přepsat dlaždice nového řádku */
+        releaseTiles(0, tileMatrixH-1, tileMatrixW, 1);
+        originRow = (originRow+tileCapacityH-1)%tileCapacityH;
+        --tileY;
+        resetTiles(0, 0, tileMatrixW, 1);
+        loadTiles(0, 0, tileMatrixW, 1);
 
         pixels -= moveY; moveY = tileH;
         return moveUp(pixels);
@@ -169,27 +343,21 @@ void Map::moveUp(unsigned int pixels) {
 
 /* Posunutí mapy dolů */
 void Map::moveDown(unsigned int pixels) {
+    Compositor::damage();
+
     /* Posun mimo načtenou oblast mapy = přidání dalšího řádku dlaždic dolů */
     if(tileMatrixH*tileH-(pixels+moveY) < (unsigned int) (*screen).h) {
-        unsigned int x = tiles.front().x,
-                     y = tiles.back().y;
-
         /* Už jsme na hranici mapy */
-        if(++y == endY) { moveY = tileMatrixH*tileH-(*screen).h; return; }
-
-        /* Smazání prvního řádku */
-        tiles.erase(tiles.begin(), tiles.begin()+tileMatrixW);
-
-        /* Naplnění nového řádku dole */
-        for(unsigned int pos = x; pos != x+tileMatrixW; ++pos) {
-            Tile tile;
-            tile.x = pos;
-            tile.y = y;
-            tile.isLoaded = false;
-            tiles.push_back(tile);
-        }
+        if(tileY+tileMatrixH == endY) { moveY = tileMatrixH*tileH-(*screen).h; return; }
+
+        /* Uvolnění horního řádku a posunutí počátku bufferu o řádek dolů,
+           stačí pak jen přepsat dlaždice nového řádku */
+        releaseTiles(0, 0, tileMatrixW, 1);
+        originRow = (originRow+1)%tileCapacityH;
+        ++tileY;
+        resetTiles(0, tileMatrixH-1, tileMatrixW, 1);
+        loadTiles(0, tileMatrixH-1, tileMatrixW, 1);
 
-        loadTiles();
         pixels -= tileMatrixH*tileH-((unsigned int) (*screen).h+moveY);
         /** @bug To mě přivádí k ověření důkazu, jestli je tileMatrixH*tileH
             vždy alespoň o tileH větší než (*screen).h? Při sudém rozměru screen
@@ -203,32 +371,20 @@ void Map::moveDown(unsigned int pixels) {
 
 /* Posunutí mapy doleva */
 void Map::moveLeft(unsigned int pixels) {
-    /* Posun mimo oblast mapy - přidání dalšího řádku dlaždic doleva */
-    if(pixels > moveX) {
+    Compositor::damage();
 
+    /* Posun mimo oblast mapy - přidání dalšího sloupce dlaždic doleva */
+    if(pixels > moveX) {
         /* Už jsme na hranici mapy */
-        if(tiles.front().x == beginX) { moveX = 0; return; }
-
-        /* Nyní se nemusí složitě mazat žádný sloupec, na začátek se přidá
-           položka, která bude představovat první dlaždici nového sloupce. Tím
-           se každá dlaždice na konci řádku stane dlaždicí na začátku řádku
-           dalšího - takže stačí už jen přepsat souřadnice. Poslední dlaždice
-           v poli se smaže, protože je zde navíc (nemá už řádek, do kterého by
-           se přesunula). */
-
-        /* Smazání poslední a přidání první položky */
-        tiles.erase(tiles.end()-1);
-        Tile tile;
-        tiles.insert(tiles.begin(), tile);
-
-        /* Přepisování souřadnic */
-        for(vector<Tile>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
-            (*it).x = (*(it+1)).x-1;
-            (*it).y = (*(it+1)).y;
-            (*it).isLoaded = false;
-        }
+        if(tileX == beginX) { moveX = 0; return; }
 
-        loadTiles();
+        /* Uvolnění pravého sloupce a posunutí počátku bufferu o sloupec
+           doleva, stačí pak jen přepsat dlaždice nového sloupce */
+        releaseTiles(tileMatrixW-1, 0, 1, tileMatrixH);
+        originCol = (originCol+tileCapacityW-1)%tileCapacityW;
+        --tileX;
+        resetTiles(0, 0, 1, tileMatrixH);
+        loadTiles(0, 0, 1, tileMatrixH);
 
         pixels -= moveX; moveX = tileW;
         return moveLeft(pixels);
@@ -239,70 +395,127 @@ void Map::moveLeft(unsigned int pixels) {
 
 /* Posunutí mapy doprava */
 void Map::moveRight(unsigned int pixels) {
-    /* Posun mimo oblast mapy - přidání dalšího řádku dlaždic doleva */
-    if(tileMatrixW*tileW-(pixels+moveX) < (unsigned int) (*screen).w) {
+    Compositor::damage();
 
+    /* Posun mimo oblast mapy - přidání dalšího sloupce dlaždic doprava */
+    if(tileMatrixW*tileW-(pixels+moveX) < (unsigned int) (*screen).w) {
         /* Už jsme na hranici mapy */
-        if(tiles.back().x == endX-1) { moveX = tileMatrixW*tileW-(*screen).w; return; }
-
-        /* Nyní se nemusí složitě mazat žádný sloupec, na konec se přidá
-        položka, která bude představovat první dlaždici nového sloupce. Tím
-        se každá dlaždice na začátku řádku stane dlaždicí na konci řádku
-        předchozího - takže stačí už jen přepsat souřadnice. První dlaždice
-        v poli se smaže, protože je zde navíc (nemá už řádek, do kterého by
-        se přesunula). */
-
-        /* Smazání první a přidání poslední položky */
-        tiles.erase(tiles.begin());
-        Tile tile;
-        tiles.push_back(tile);
-
-        /* Přepisování souřadnic */
-        for(vector<Tile>::iterator it = tiles.begin()+tileMatrixW-1; it != tiles.end(); ++it) {
-            (*it).x = (*(it-1)).x+1;
-            (*it).y = (*(it-1)).y;
-            (*it).isLoaded = false;
-        }
+        if(tileX+tileMatrixW == endX) { moveX = tileMatrixW*tileW-(*screen).w; return; }
 
-        loadTiles();
+        /* Uvolnění levého sloupce a posunutí počátku bufferu o sloupec
+           doprava, stačí pak jen přepsat dlaždice nového sloupce */
+        releaseTiles(0, 0, 1, tileMatrixH);
+        originCol = (originCol+1)%tileCapacityW;
+        ++tileX;
+        resetTiles(tileMatrixW-1, 0, 1, tileMatrixH);
+        loadTiles(tileMatrixW-1, 0, 1, tileMatrixH);
 
         pixels -= tileMatrixW*tileW-((unsigned int) (*screen).w+moveX);
         /** @bug To mě přivádí k ověření důkazu, jestli je tileMatrixW*tileW
         vždy alespoň o tileW větší než (*screen).w? Při sudém rozměru screen
         by to mělo být dodrženo, při lichém ne */
         moveX -= tileW;
-        return moveLeft(pixels);
+        return moveRight(pixels);
     }
 
     moveX += pixels;
 }
 
-/* Zobrazení mapy */
-void Map::view(TTF_Font** font, SDL_Color* color) {
+/* Aktualizace mapy */
+void Map::update(void) {
     /* Co kdyby náhodou někdo změnil velilkost okna */
-    if(resizeMatrix()) loadTiles();
+    if(resizeMatrix()) {
+        loadTiles();
+        Compositor::damage();
+    }
+
+    /* Dlaždice, které se mezitím načetly */
+    collectTiles();
+
+    /* Předem načtení dlaždic ve směru posunu */
+    updateVelocity();
+    prefetchTiles();
+}
+
+/* Zda se mapa ještě mění */
+bool Map::busy(void) const {
+    return velocityX != 0 || velocityY != 0 || (*loader).pending();
+}
 
-    /* Počáteční x a y souřadnice (předpokládá, že je vektor správně seřazený) */
-    unsigned int x = tiles.front().x;
-    unsigned int y = tiles.front().y;
+/* Oblast mapy */
+SDL_Rect Map::bounds(void) {
+    SDL_Rect area = {0, 0, (*screen).w, (*screen).h};
+    return area;
+}
+
+/* Zda je mapa neprůhledná */
+bool Map::isOpaque(void) const {
+    for(vector<Tile>::size_type row = 0; row != tileMatrixH; ++row) {
+        for(vector<Tile>::size_type col = 0; col != tileMatrixW; ++col) {
+            const Tile& t = tile(col, row);
+            if(t.state != LOADED || (unsigned int) (*t.image).w < tileW || (unsigned int) (*t.image).h < tileH)
+                return false;
+        }
+    }
+
+    return tileMatrixW != 0 && tileMatrixH != 0;
+}
+
+/* Zobrazení mapy */
+void Map::view(void) {
+    /* Popisky jen pokud jsou zapnuté a nastavené */
+    bool labels = _tileLabels && labelFontSource != NULL;
+    TTF_Font** font = labelFontSource;
+    SDL_Color* color = labelColorSource;
+
+    /* Změnil se font, barva nebo vyhlazování, popisky se musí vyrenderovat
+       znovu (všechny, ne jen v aktuálně překreslované oblasti) */
+    if(labels && (*font != labelFont || (*color).r != labelColor.r ||
+       (*color).g != labelColor.g || (*color).b != labelColor.b ||
+       Effects::smoothText != labelSmoothText)) {
+        releaseLabels();
+        labelFont = *font;
+        labelColor = *color;
+        labelSmoothText = Effects::smoothText;
+        Compositor::damage();
+    }
+
+    /* Překreslovaná oblast */
+    const SDL_Rect& clip = (*screen).clip_rect;
 
     /* Zobrazování jednotlivých dlaždic */
-    for (vector<Tile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
-        SDL_Rect tileCrop;
-        SDL_Rect tilePosition = Effects::align(screen, ALIGN_DEFAULT, tileW, tileH,
-            ((*it).x-x)*tileW-moveX, ((*it).y-y)*tileH-moveY, &tileCrop);
-
-        SDL_BlitSurface(*(*it).image, &tileCrop, screen, &tilePosition);
-
-        /* Text */
-        /** <<< debug */
-        std::ostringstream title;
-        title << "[" << (*it).x << ":" << (*it).y << "]";
-        SDL_Surface* text = (*Effects::textRenderFunction())(*font, title.str().c_str(), *color);
-        tilePosition = Effects::align(tilePosition, (Align) (ALIGN_CENTER|ALIGN_MIDDLE), (*text).w, (*text).h, 0, 64, &tileCrop);
-        SDL_BlitSurface(text, &tileCrop, screen, &tilePosition);
-        SDL_FreeSurface(text);
-        /** >>> debug */
+    for(vector<Tile>::size_type row = 0; row != tileMatrixH; ++row) {
+        for(vector<Tile>::size_type col = 0; col != tileMatrixW; ++col) {
+            Tile& t = tile(col, row);
+
+            /* Dlaždice mimo překreslovanou oblast */
+            int x = (int) (col*tileW)-(int) moveX, y = (int) (row*tileH)-(int) moveY;
+            if(x >= clip.x+clip.w || y >= clip.y+clip.h ||
+               x+(int) tileW <= clip.x || y+(int) tileH <= clip.y) continue;
+
+            SDL_Rect tileCrop;
+            SDL_Rect tilePosition = Effects::align(screen, ALIGN_DEFAULT, tileW, tileH, x, y, &tileCrop);
+
+            /* Obrázek podle stavu dlaždice */
+            SDL_Surface* image;
+            if(t.state == LOADED) image = t.image;
+            else if(t.state == NOT_FOUND) image = *tileNotFound;
+            else image = *tileLoading;
+
+            SDL_Rect imagePosition = tilePosition;
+            SDL_BlitSurface(image, &tileCrop, screen, &imagePosition);
+
+            /* Popisek se souřadnicemi, renderuje se jen poprvé */
+            if(!labels) continue;
+            if(t.label == NULL) {
+                std::ostringstream title;
+                title << "[" << t.x << ":" << t.y << "]";
+                t.label = (*Effects::textRenderFunction())(*font, title.str().c_str(), *color);
+                if(t.label == NULL) continue;
+            }
+            tilePosition = Effects::align(tilePosition, (Align) (ALIGN_CENTER|ALIGN_MIDDLE), (*t.label).w, (*t.label).h, 0, 64, &tileCrop);
+            SDL_BlitSurface(t.label, &tileCrop, screen, &tilePosition);
+        }
     }
 }
 
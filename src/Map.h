@@ -20,27 +20,70 @@
  * @brief Třída Map
  */
 
+#include <set>
+#include <string>
 #include <vector>
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 
 #include "FPS.h"
+#include "Scene.h"
+#include "utility.h"
 
 namespace Kompas { namespace Sdl {
 
+class TileCache;
+class TileLoader;
+class TilePackage;
+
 /**
  * @brief Zobrazení mapy
  *
- * Base třída umožňující zobrazování mapových dlaždic na obrazovku
+ * Base třída umožňující zobrazování mapových dlaždic na obrazovku. Dlaždice se
+ * načítají asynchronně pomocí TileLoader, do jejich načtení je místo nich
+ * zobrazován obrázek tileLoading. Dlaždice, které odrolují mimo obrazovku, se
+ * ukládají do TileCache, aby se při návratu nemusely načítat znovu.
+ *
+ * Podle rychlosti posunu mapy se s nízkou prioritou předem načítají dlaždice
+ * za okrajem obrazovky ve směru posunu, takže po odrolování jsou už v cache.
  */
-class Map {
+class Map: public SceneNode {
     public:
         /**
          * @brief Konstruktor
          *
+         * @param   _screen         Displejová surface
+         * @param   _tileLoading    Obrázek zobrazovaný místo dlaždice při
+         *  jejím načítání
+         * @param   _tileNotFound   Obrázek zobrazovaný místo dlaždice, kterou
+         *  se nepodařilo načíst
+         * @param   _tileCacheSize  Velikost cache dlaždic v kilobajtech (viz
+         *  TileCache)
+         * @param   _prefetchDepth  Maximální počet řad dlaždic předem
+         *  načítaných ve směru posunu (0 vypne předem načítání)
+         * @param   tileDirectory   Adresář s dlaždicemi (viz TileLoader)
+         * @param   _loaderThreads  Počet vláken načítajících dlaždice
          * @note Pro správnou funkčnost posouvání musí být inicializována třída FPS.
          */
-        Map(SDL_Surface* _screen, SDL_Surface** _tileLoading, SDL_Surface** _tileNotFound);
+        Map(SDL_Surface* _screen, SDL_Surface** _tileLoading, SDL_Surface** _tileNotFound, int* _tileCacheSize, int* _prefetchDepth, const std::string& tileDirectory, unsigned int _loaderThreads = 2);
+
+        /**
+         * @brief Destruktor
+         *
+         * Zruší nedokončené požadavky na dlaždice a uvolní načtené dlaždice.
+         */
+        ~Map(void);
+
+        /**
+         * @brief Otevření mapového balíčku
+         *
+         * Zahodí všechny dlaždice (i z cache) a dále načítá dlaždice z
+         * daného balíčku (viz TilePackage).
+         * @param   file    Soubor s balíčkem
+         * @return  Zda se balíček podařilo otevřít. Pokud ne, mapa zůstane
+         *  beze změny.
+         */
+        bool open(const std::string& file);
 
         /** @brief Posun nahoru */
         void moveUp(unsigned int pixels);
@@ -54,12 +97,95 @@ class Map {
         /** @brief Posun doprava */
         void moveRight(unsigned int pixels);
 
+        /**
+         * @brief Aktualizace mapy
+         *
+         * Převezme načtené dlaždice, zažádá o předem načtení dalších a
+         * poškozené oblasti nahlásí do Compositor. Volá se jednou za snímek
+         * před zobrazením.
+         */
+        void update(void);
+
+        /**
+         * @brief Zda mapa potřebuje další snímky
+         *
+         * Mapa je zaneprázdněná, dokud se načítají dlaždice nebo dokud
+         * nedozněla rychlost posunu. Jinak se může hlavní smyčka uspat až do
+         * další události.
+         */
+        bool busy(void) const;
+
+        /**
+         * @brief Nastavení popisků dlaždic
+         *
+         * @param   font    Font popisků dlaždic
+         * @param   color   Barva popisků dlaždic
+         */
+        inline void configureLabels(TTF_Font** font, SDL_Color* color) {
+            labelFontSource = font;
+            labelColorSource = color;
+        }
+
         /**
          * @brief Zobrazení mapy
+         *
+         * Vykreslí jen dlaždice zasahující do ořezového obdélníku displeje.
+         * Popisky dlaždic se vykreslí jen, pokud jsou nastavené (viz
+         * Map::configureLabels).
+         */
+        void view(void);
+
+        /** @brief Oblast mapy (celá obrazovka) */
+        SDL_Rect bounds(void);
+
+        /**
+         * @brief Zda je mapa neprůhledná
+         *
+         * Matice dlaždic vždy pokrývá celou obrazovku, neprůhledná je ale jen,
+         * pokud jsou všechny zobrazené dlaždice načtené. Obrázky pro
+         * načítanou a nenalezenou dlaždici jsou ze skinu a mohou být
+         * průhledné.
+         */
+        bool isOpaque(void) const;
+
+        /**
+         * @brief Zapnutí / vypnutí popisků dlaždic
+         *
+         * Popisky se souřadnicemi dlaždic jsou defaultně zapnuté. Při vypnutí
+         * se uvolní všechny vyrenderované popisky.
+         */
+        void setTileLabels(bool enabled);
+
+        /** @brief Zda jsou zapnuté popisky dlaždic */
+        inline bool tileLabels(void) const { return _tileLabels; }
+
+        /**
+         * @brief Cache dlaždic
+         *
+         * Pro zjištění statistik cache (viz TileCache::hits, TileCache::misses,
+         * TileCache::evictions).
+         */
+        inline const TileCache& tileCache(void) const { return *cache; }
+
+        /** @brief Počet dlaždic zažádaných předem */
+        inline unsigned int prefetchRequests(void) const { return _prefetchRequests; }
+
+        /**
+         * @brief Počet úspěšně předem načtených dlaždic
+         *
+         * Dlaždice, které byly při odkrytí již načtené v cache.
          */
-        void view(TTF_Font** font, SDL_Color* color);
+        inline unsigned int prefetchHits(void) const { return _prefetchHits; }
 
     private:
+        /** @brief Stav dlaždice */
+        enum TileState {
+            EMPTY = 0,              /**< @brief Dlaždice ještě nebyla požadována */
+            LOADING,                /**< @brief Dlaždice se načítá */
+            LOADED,                 /**< @brief Dlaždice je načtena */
+            NOT_FOUND               /**< @brief Dlaždici se nepodařilo načíst */
+        };
+
         /**
          * @brief Mapová dlaždice
          * @todo Bacha, jsme limitováni velikostí 32bit int (tj. ani teoreticky
@@ -68,8 +194,17 @@ class Map {
         struct Tile {
             unsigned int x,         /** @brief X-ová souřadnice dlaždice */
                          y;         /** @brief Y-ová souřadnice dlaždice */
-            SDL_Surface** image;    /** @brief Obrázek dlaždice */
-            bool isLoaded;          /** @brief Zda je dlaždice načtena */
+            SDL_Surface* image;     /** @brief Obrázek dlaždice (jen u načtené dlaždice) */
+            TileState state;        /** @brief Stav dlaždice */
+
+            /**
+             * @brief Vyrenderovaný popisek se souřadnicemi dlaždice
+             *
+             * Renderuje se při prvním zobrazení, uvolňuje se spolu s
+             * dlaždicí (tj. při změně souřadnic). NULL, pokud ještě nebyl
+             * vyrenderován.
+             */
+            SDL_Surface* label;
         };
 
         SDL_Surface* screen;        /** @brief Displejová surface */
@@ -81,8 +216,38 @@ class Map {
                      tileH;         /** @brief Výška dlaždice */
         std::vector<Tile>::size_type
             tileMatrixW,            /** @brief Šířka matice s dlaždicemi */
-            tileMatrixH;            /** @brief Výška matice s dlaždicemi */
-        std::vector<Tile> tiles;    /** @brief Vektor s dlaždicemi */
+            tileMatrixH,            /** @brief Výška matice s dlaždicemi */
+            tileCapacityW,          /** @brief Šířka kruhového bufferu s dlaždicemi */
+            tileCapacityH,          /** @brief Výška kruhového bufferu s dlaždicemi */
+            originCol,              /** @brief Sloupec levé horní dlaždice v kruhovém bufferu */
+            originRow;              /** @brief Řádek levé horní dlaždice v kruhovém bufferu */
+
+        /**
+         * @brief Kruhový buffer s dlaždicemi
+         *
+         * Dvourozměrné pole o velikosti tileCapacityW x tileCapacityH, jehož
+         * počátek (levá horní zobrazená dlaždice) je na pozici originCol,
+         * originRow a pokračuje se za koncem řádku / sloupce opět od začátku.
+         * Při posunu mapy o celou dlaždici se jen posune počátek a přepíšou
+         * se dlaždice v nově odkrytém řádku či sloupci. Viz Map::tile.
+         */
+        std::vector<Tile> tiles;
+
+        unsigned int zoom,          /** @brief Úroveň přiblížení */
+                     tileX,         /** @brief X-ová souřadnice levé horní dlaždice */
+                     tileY;         /** @brief Y-ová souřadnice levé horní dlaždice */
+
+        unsigned int loaderThreads; /** @brief Počet vláken načítajících dlaždice */
+        /**
+         * @brief Otevřený mapový balíček
+         *
+         * NULL, pokud se načítá z adresáře. Dlaždice z balíčku se surovými
+         * dlaždicemi mohou ukazovat přímo do jeho paměti, proto se smí
+         * zavřít až po uvolnění všech dlaždic (i z cache).
+         */
+        TilePackage* package;
+        TileLoader* loader;         /** @brief Asynchronní načítání dlaždic */
+        TileCache* cache;           /** @brief Cache dlaždic mimo obrazovku */
 
         unsigned int beginX,        /** @brief Počáteční x-ová souřadnice mapy */
                      beginY,        /** @brief Počáteční y-ová souřadnice mapy */
@@ -95,6 +260,45 @@ class Map {
             moveXData,              /** @brief Data pro X-ové posunutí */
             moveYData;              /** @brief Data pro Y-ové posunutí */
 
+        int* prefetchDepth;         /** @brief Maximální počet předem načítaných řad dlaždic */
+        unsigned int lastTileX,     /** @brief tileX při minulém zobrazení */
+                     lastTileY,     /** @brief tileY při minulém zobrazení */
+                     lastMoveX,     /** @brief moveX při minulém zobrazení */
+                     lastMoveY;     /** @brief moveY při minulém zobrazení */
+        int velocityX,              /** @brief Vyhlazená X-ová rychlost posunu (pixely za sekundu) */
+            velocityY,              /** @brief Vyhlazená Y-ová rychlost posunu (pixely za sekundu) */
+            prefetchX,              /** @brief X-ový směr předem načítání (-1, 0, 1) */
+            prefetchY;              /** @brief Y-ový směr předem načítání (-1, 0, 1) */
+
+        /** @brief Předem zažádané dlaždice, které ještě nebyly odkryty */
+        std::set<TileCoordinates> prefetched;
+
+        bool _tileLabels;           /** @brief Zda jsou zapnuté popisky dlaždic */
+        TTF_Font* labelFont;        /** @brief Font, kterým jsou vyrenderované popisky */
+        SDL_Color labelColor;       /** @brief Barva, kterou jsou vyrenderované popisky */
+        bool labelSmoothText;       /** @brief Zda jsou popisky vyrenderované vyhlazeně */
+        TTF_Font** labelFontSource; /** @brief Font popisků (ze skinu) */
+        SDL_Color* labelColorSource; /** @brief Barva popisků (ze skinu) */
+
+        unsigned int _prefetchRequests, /** @brief Počet dlaždic zažádaných předem */
+                     _prefetchHits; /** @brief Počet úspěšně předem načtených dlaždic */
+
+        /**
+         * @brief Dlaždice v zobrazené matici
+         *
+         * @param   col     Sloupec v zobrazené matici (0 je vlevo)
+         * @param   row     Řádek v zobrazené matici (0 je nahoře)
+         * @return  Reference na dlaždici v kruhovém bufferu
+         */
+        inline Tile& tile(std::vector<Tile>::size_type col, std::vector<Tile>::size_type row) {
+            return tiles[((originRow+row)%tileCapacityH)*tileCapacityW+(originCol+col)%tileCapacityW];
+        }
+
+        /** @brief Dlaždice v zobrazené matici (konstantní verze) */
+        inline const Tile& tile(std::vector<Tile>::size_type col, std::vector<Tile>::size_type row) const {
+            return tiles[((originRow+row)%tileCapacityH)*tileCapacityW+(originCol+col)%tileCapacityW];
+        }
+
         /**
         * @brief Změna velikosti matice
         *
@@ -105,26 +309,109 @@ class Map {
         * 2 další řady (na každém konci jedna v jednopixelovém proužku). Toto
         * funguje i v případě, že daný rozměr je menší než rozměr dlaždice.
         *
+        * <strong>Realokace bufferu:</strong> Kruhový buffer se realokuje jen
+        * tehdy, když se do něj zvětšená matice nevejde. Zachované dlaždice se
+        * přitom přesunou tak, aby počátek bufferu byl na nule. Při zmenšení
+        * okna kapacita zůstává a přebývající řádky a sloupce vpravo a dole se
+        * jen přestanou zobrazovat.
+        *
         * <strong>Přidávání nových dlaždic:</strong> Nové dlaždice se přidávají
         * k existujícím (ty se netvoří znova, škoda procesorového času) -
         * doplňují se prázdné sloupce vpravo a řádky dole, aby se zachovala
-        * návaznost původních dlaždic. Pokud je okno zmenšováno, jsou
-        * odstraněny řádky a sloupce vpravo a dole.
+        * návaznost původních dlaždic.
         * @return Zda se velikost matice změnila
         *
         * @todo Přidávat a odebírat s ohledem na zachování vycentrované pozice
         * souměrně vlevo a vpravo, dolů a nahoru (aby pak nedocházelo ke
         * znovunačítání smazaných dlaždic)
-        * @todo Priority načítání, multithread, semafory...
         */
         bool resizeMatrix(void);
 
+        /**
+         * @brief Uvolnění dlaždic v oblasti matice
+         *
+         * Zruší požadavky na načítané dlaždice v dané oblasti zobrazené
+         * matice, obrázky načtených přesune do cache, uvolní jejich popisky
+         * a označí je jako prázdné.
+         * @param   col     Počáteční sloupec oblasti
+         * @param   row     Počáteční řádek oblasti
+         * @param   cols    Počet sloupců oblasti
+         * @param   rows    Počet řádků oblasti
+         */
+        void releaseTiles(std::vector<Tile>::size_type col, std::vector<Tile>::size_type row, std::vector<Tile>::size_type cols, std::vector<Tile>::size_type rows);
+
+        /**
+         * @brief Uvolnění popisků dlaždic v celém bufferu
+         *
+         * Při změně fontu či barvy popisků nebo jejich vypnutí.
+         */
+        void releaseLabels(void);
+
+        /**
+         * @brief Nastavení souřadnic dlaždic v oblasti matice
+         *
+         * Uvolní dlaždice v dané oblasti zobrazené matice (viz
+         * Map::releaseTiles) a nastaví jim souřadnice podle jejich pozice.
+         * @param   col     Počáteční sloupec oblasti
+         * @param   row     Počáteční řádek oblasti
+         * @param   cols    Počet sloupců oblasti
+         * @param   rows    Počet řádků oblasti
+         */
+        void resetTiles(std::vector<Tile>::size_type col, std::vector<Tile>::size_type row, std::vector<Tile>::size_type cols, std::vector<Tile>::size_type rows);
+
         /**
          * @brief Načtení mapových dlaždic
          *
-         * Najde ve vektoru dlaždic nenačtené a načte je
+         * Najde v dané oblasti zobrazené matice prázdné dlaždice a vezme je z
+         * cache, pokud tam nejsou, zažádá o jejich načtení.
+         * @param   col     Počáteční sloupec oblasti
+         * @param   row     Počáteční řádek oblasti
+         * @param   cols    Počet sloupců oblasti
+         * @param   rows    Počet řádků oblasti
+         */
+        virtual void loadTiles(std::vector<Tile>::size_type col, std::vector<Tile>::size_type row, std::vector<Tile>::size_type cols, std::vector<Tile>::size_type rows);
+
+        /**
+         * @brief Načtení všech mapových dlaždic
+         *
+         * Najde v celé zobrazené matici prázdné dlaždice a zažádá o jejich
+         * načtení.
+         */
+        inline void loadTiles(void) { loadTiles(0, 0, tileMatrixW, tileMatrixH); }
+
+        /**
+         * @brief Převzetí načtených dlaždic
+         *
+         * Převezme od TileLoader hotové dlaždice a přiřadí je do matice.
+         * Dlaždice, které mezitím z matice odrolovaly, uloží do cache.
+         */
+        void collectTiles(void);
+
+        /**
+         * @brief Výpočet rychlosti posunu
+         *
+         * Z posunu od minulého zobrazení a doby trvání snímku (viz
+         * FPS::frameTime) vypočítá vyhlazenou rychlost posunu mapy.
+         */
+        void updateVelocity(void);
+
+        /**
+         * @brief Předem načtení dlaždic ve směru posunu
+         *
+         * Podle rychlosti posunu zažádá s nízkou prioritou o dlaždice za
+         * okrajem matice. Počet řad odpovídá vzdálenosti, kterou mapa urazí
+         * za sekundu, maximálně však prefetchDepth. Při změně směru se
+         * nevyřízené požadavky zruší.
+         */
+        void prefetchTiles(void);
+
+        /**
+         * @brief Předem načtení jedné dlaždice
+         *
+         * Pokud dlaždice není v cache ani už zažádaná, zažádá o ni s nízkou
+         * prioritou.
          */
-        virtual void loadTiles(void);
+        void prefetchTile(unsigned int x, unsigned int y);
 };
 
 }}
@@ -0,0 +1,77 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+MappedFile::MappedFile(const string& file): valid(false), _data(NULL), _size(0) {
+    #ifdef _WIN32
+    this->file = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mapping = NULL;
+    if(this->file == INVALID_HANDLE_VALUE) return;
+
+    _size = GetFileSize(this->file, NULL);
+    if(_size == 0) {
+        valid = true;
+        return;
+    }
+
+    if((mapping = CreateFileMapping(this->file, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL)
+        _data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    #else
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if(fd == -1) return;
+
+    struct stat info;
+    if(fstat(fd, &info) == 0) {
+        _size = info.st_size;
+        if(_size == 0) valid = true;
+        else {
+            void* mapped = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+            if(mapped != MAP_FAILED) _data = static_cast<const unsigned char*>(mapped);
+        }
+    }
+
+    /* The mapping stays valid after closing the file */
+    close(fd);
+    #endif
+
+    if(_data != NULL) valid = true;
+    else if(!valid) _size = 0;
+}
+
+MappedFile::~MappedFile(void) {
+    #ifdef _WIN32
+    if(_data != NULL) UnmapViewOfFile(_data);
+    if(mapping != NULL) CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    #else
+    if(_data != NULL) munmap(const_cast<unsigned char*>(_data), _size);
+    #endif
+}
+
+}}
@@ -0,0 +1,72 @@
+#ifndef Kompas_Sdl_MappedFile_h
+#define Kompas_Sdl_MappedFile_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Sdl::MappedFile
+ */
+
+#include <string>
+
+namespace Kompas { namespace Sdl {
+
+/**
+ * @brief Read-only memory-mapped file
+ *
+ * Maps the whole file with mmap() (or MapViewOfFile() on Windows), so
+ * nothing is read up front and the data are paged in on first access. The
+ * mapping is owned by the instance and is valid until it is destroyed.
+ */
+class MappedFile {
+    public:
+        /**
+         * @brief Constructor
+         * @param file          File to map
+         *
+         * If the file cannot be opened or mapped, the instance is invalid
+         * (see isValid()). Empty file is valid, but has no data.
+         */
+        MappedFile(const std::string& file);
+
+        /** @brief Destructor, unmaps the file */
+        ~MappedFile(void);
+
+        /** @brief Whether the file was successfully opened and mapped */
+        inline bool isValid(void) const { return valid; }
+
+        /** @brief Mapped data (NULL if the file is invalid or empty) */
+        inline const unsigned char* data(void) const { return _data; }
+
+        /** @brief Data size */
+        inline unsigned int size(void) const { return _size; }
+
+    private:
+        bool valid;
+        const unsigned char* _data;
+        unsigned int _size;
+
+        #ifdef _WIN32
+        void *file, *mapping;
+        #endif
+
+        /* Copying is not allowed (the mapping is owned by the instance) */
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+};
+
+}}
+
+#endif
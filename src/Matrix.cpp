@@ -15,7 +15,8 @@
 
 #include "Matrix.h"
 
-#include <algorithm>    /* sort() */
+#include <algorithm>    /* sort(), lower_bound(), upper_bound() */
+#include <climits>      /* INT_MIN, INT_MAX */
 
 using namespace std;
 
@@ -23,14 +24,20 @@ namespace Kompas { namespace Sdl {
 
 /* Zakázání položky */
 template<class Item> void Matrix<Item>::disableItem(itemId item) {
+    if(items[item].flags & DISABLED) return;
+
+    eraseSorted(item);
     items[item].flags |= DISABLED;
-    reloadItems();
+    damage();
 }
 
 /* Povolení položky */
 template<class Item> void Matrix<Item>::enableItem(itemId item) {
+    if(!(items[item].flags & DISABLED)) return;
+
     items[item].flags &= ~DISABLED;
-    reloadItems();
+    insertSorted(item);
+    damage();
 }
 
 /* Obnovení položek */
@@ -39,153 +46,149 @@ template<class Item> void Matrix<Item>::reloadItems() {
     sortedVertical.clear();     sortedVertical.reserve(items.size());
 
     /* Naplnění tříděných jen aktivními položkami */
-    for(typename vector<Item>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        if(!((*it).flags & DISABLED)) {
-            sortedHorizontal.push_back(it);
-            sortedVertical.push_back(it);
+    for(itemId i = 0; i != items.size(); ++i) {
+        if(!(items[i].flags & DISABLED)) {
+            sortedHorizontal.push_back(i);
+            sortedVertical.push_back(i);
         }
     }
 
-    sort(sortedHorizontal.begin(), sortedHorizontal.end(), horizontalCompare);
-    sort(sortedVertical.begin(), sortedVertical.end(), verticalCompare);
+    sort(sortedHorizontal.begin(), sortedHorizontal.end(), horizontalCompare());
+    sort(sortedVertical.begin(), sortedVertical.end(), verticalCompare());
 
-    if(sortedVertical.size() != 0) actualItem = sortedVertical.front();
+    if(sortedVertical.size() != 0) actualItem = items.begin()+sortedVertical.front();
     else actualItem = items.end();
+    damage();
 }
 
-/* Posun nahoru */
-template<class Item> bool Matrix<Item>::moveUp(void) {
-    if(sortedHorizontal.size() == 0) return false;
+/* Přidání položky */
+template<class Item> typename Matrix<Item>::itemId Matrix<Item>::insertItem(const Item& item) {
+    /* Zapamatování aktuální položky, přidáním se mohou ukazatele zneplatnit */
+    bool selected = actualItem != items.end();
+    itemId actual = actualItem - items.begin();
 
-    /* Nalezení aktuální položky */
-    typename vector<typename vector<Item>::const_iterator>::const_iterator it = sortedHorizontal.begin();
-    for( ; it != sortedHorizontal.end(); ++it) {
-        if(*it == actualItem) break;
-    }
+    items.push_back(item);
+    itemId id = items.size()-1;
 
-    /* Hledání jiného řádku (nekonečné procházení, dokud se nevrátíme zpět na počáteční položku) */
-    do {
-        if(it-- == sortedHorizontal.begin()) it = sortedHorizontal.end()-1;
-    } while(*it != actualItem && (**it).y == (*actualItem).y);
+    actualItem = selected ? items.begin()+actual : items.end();
+    if(!(item.flags & DISABLED)) insertSorted(id);
 
-    /* Žádný jiný řádek neexistuje, jsme zpět na aktuální položce */
-    if(*it == actualItem) return false;
+    damage();
+    return id;
+}
 
-    /* Hledání lepšího kandidáta v daném řádku (y) - blíže k x než předešlý */
-    int y = (**it).y;   int x = (*actualItem).x;    actualItem = *it;
-    while(it-- != sortedHorizontal.begin() && (**it).y == y) {
+/* Odebrání položky */
+template<class Item> void Matrix<Item>::removeItem(itemId item) {
+    if(!(items[item].flags & DISABLED)) eraseSorted(item);
 
-        /* Pokud je položka blíže aktuální než předešlý kandidát, přiřazení */
-        if( ((**it).x <= x && (*actualItem).x < (**it).x) || /* vlevo od aktuální */
-            ((**it).x >= x && (*actualItem).x > (**it).x)    /* vpravo od aktuální */
-        ) actualItem = *it;
+    /* Zapamatování aktuální položky, odebráním se posunou */
+    itemId actual = actualItem - items.begin();
+    bool selected = actualItem != items.end();
 
-        /* Položka je dále než předešlý kandidát, konec */
-        else break;
-    }
+    items.erase(items.begin()+item);
 
-    return true;
-}
+    /* Posun ID za odebranou položkou (bez změny pořadí) */
+    for(typename vector<itemId>::iterator it = sortedHorizontal.begin(); it != sortedHorizontal.end(); ++it)
+        if(*it > item) --*it;
+    for(typename vector<itemId>::iterator it = sortedVertical.begin(); it != sortedVertical.end(); ++it)
+        if(*it > item) --*it;
 
-/* Posun dolů */
-template<class Item> bool Matrix<Item>::moveDown(void) {
-    if(sortedHorizontal.size() == 0) return false;
+    if(!selected) actualItem = items.end();
+    else actualItem = items.begin() + (actual > item ? actual-1 : actual);
 
-    /* Nalezení aktuální položky */
-    typename vector<typename vector<Item>::const_iterator>::const_iterator it = sortedHorizontal.begin();
-    for( ; it != sortedHorizontal.end(); ++it) {
-        if(*it == actualItem) break;
-    }
+    damage();
+}
 
-    /* Hledání jiného řádku (nekonečné procházení, dokud se nevrátíme zpět na počáteční položku) */
-    do {
-        if(++it == sortedHorizontal.end()) it = sortedHorizontal.begin();
-    } while(*it != actualItem && (**it).y == (*actualItem).y);
+/* Vložení položky do řazených vektorů */
+template<class Item> void Matrix<Item>::insertSorted(itemId item) {
+    sortedHorizontal.insert(upper_bound(sortedHorizontal.begin(), sortedHorizontal.end(), item, horizontalCompare()), item);
+    sortedVertical.insert(upper_bound(sortedVertical.begin(), sortedVertical.end(), item, verticalCompare()), item);
 
-    /* Žádný jiný řádek neexistuje, jsme zpět na aktuální položce */
-    if(*it == actualItem) return false;
+    /* Žádná položka nebyla aktivní, aktuální je tato */
+    if(actualItem == items.end()) actualItem = items.begin()+item;
+}
 
-    /* Hledání lepšího kandidáta v daném řádku (y) - blíže k x než předešlý */
-    int y = (**it).y;   int x = (*actualItem).x;    actualItem = *it;
-    while(++it != sortedHorizontal.end() && (**it).y == y) {
+/* Vyjmutí položky z řazených vektorů */
+template<class Item> void Matrix<Item>::eraseSorted(itemId item) {
+    sortedHorizontal.erase(lower_bound(sortedHorizontal.begin(), sortedHorizontal.end(), item, horizontalCompare()));
 
-        /* Pokud je položka blíže aktuální než předešlý kandidát, přiřazení */
-        if( ((**it).x <= x && (*actualItem).x < (**it).x) || /* vlevo od aktuální */
-            ((**it).x >= x && (*actualItem).x > (**it).x)    /* vpravo od aktuální */
-        ) actualItem = *it;
+    typename vector<itemId>::iterator it = sortedVertical.erase(lower_bound(sortedVertical.begin(), sortedVertical.end(), item, verticalCompare()));
 
-        /* Položka je dále než předešlý kandidát, konec */
-        else break;
+    /* Vyjmutá položka byla aktuální, aktuální bude následující */
+    if(actualItem == items.begin()+item) {
+        if(sortedVertical.empty()) actualItem = items.end();
+        else actualItem = items.begin() + (it == sortedVertical.end() ? sortedVertical.front() : *it);
     }
+}
 
-    return true;
+/* Posun nahoru */
+template<class Item> bool Matrix<Item>::moveUp(void) {
+    return moveBackward(sortedHorizontal, horizontalCompare());
+}
+
+/* Posun dolů */
+template<class Item> bool Matrix<Item>::moveDown(void) {
+    return moveForward(sortedHorizontal, horizontalCompare());
 }
 
 /* Posun doleva */
 template<class Item> bool Matrix<Item>::moveLeft(void) {
-    if(sortedVertical.size() == 0) return false;
+    return moveBackward(sortedVertical, verticalCompare());
+}
 
-    /* Nalezení aktuální položky */
-    typename vector<typename vector<Item>::const_iterator>::const_iterator it = sortedVertical.begin();
-    for( ; it != sortedVertical.end(); ++it) {
-        if(*it == actualItem) break;
-    }
+/* Posun doprava */
+template<class Item> bool Matrix<Item>::moveRight(void) {
+    return moveForward(sortedVertical, verticalCompare());
+}
 
-    /* Hledání jiného sloupce (nekonečné procházení, dokud se nevrátíme zpět na počáteční položku) */
-    do {
-        if(it-- == sortedVertical.begin()) it = sortedVertical.end()-1;
-    } while(*it != actualItem && (**it).x == (*actualItem).x);
+/* Posun na předchozí řádek / sloupec */
+template<class Item> bool Matrix<Item>::moveBackward(const vector<itemId>& sorted, const KeyCompare& compare) {
+    if(sorted.size() == 0) return false;
 
-    /* Žádný jiný sloupec neexistuje, jsme zpět na aktuální položce */
-    if(*it == actualItem) return false;
+    Key actual = compare.key(*actualItem);
 
-    /* Hledání lepšího kandidáta v daném sloupci (x) - blíže k y než předešlý */
-    int x = (**it).x;   int y = (*actualItem).y;    actualItem = *it;
-    while(it-- != sortedVertical.begin() && (**it).x == x) {
+    /* Poslední položka předchozího řádku (cyklicky) */
+    typename vector<itemId>::const_iterator it = lower_bound(sorted.begin(), sorted.end(), Key(actual.major, INT_MIN), compare);
+    if(it == sorted.begin()) it = sorted.end();
+    itemId last = *--it;
+    int line = compare.key(items[last]).major;
 
-        /* Pokud je položka blíže aktuální než předešlý kandidát, přiřazení */
-        if( ((**it).y <= y && (*actualItem).y < (**it).y) || /* výše než aktuální */
-            ((**it).y >= y && (*actualItem).y > (**it).y)    /* níže než aktuální */
-        ) actualItem = *it;
+    /* Žádný jiný řádek neexistuje */
+    if(line == actual.major) return false;
 
-        /* Položka je dále než předešlý kandidát, konec */
-        else break;
-    }
+    /* Nejbližší položka v daném řádku na pozici aktuální nebo za ní (z více
+       položek na stejné pozici ta poslední), pokud žádná není, poslední
+       položka řádku */
+    it = lower_bound(sorted.begin(), sorted.end(), Key(line, actual.minor), compare);
+    if(it == sorted.end() || compare.key(items[*it]).major != line) actualItem = items.begin()+last;
+    else actualItem = items.begin() + *(upper_bound(sorted.begin(), sorted.end(), compare.key(items[*it]), compare)-1);
 
+    damage();
     return true;
 }
 
-/* Posun doprava */
-template<class Item> bool Matrix<Item>::moveRight(void) {
-    if(sortedVertical.size() == 0) return false;
-
-    /* Nalezení aktuální položky */
-    typename vector<typename vector<Item>::const_iterator>::const_iterator it = sortedVertical.begin();
-    for( ; it != sortedVertical.end(); ++it) {
-        if(*it == actualItem) break;
-    }
-
-    /* Hledání jiného sloupce (nekonečné procházení, dokud se nevrátíme zpět na počáteční položku) */
-    do {
-        if(++it == sortedVertical.end()) it = sortedVertical.begin();
-    } while(*it != actualItem && (**it).x == (*actualItem).x);
+/* Posun na další řádek / sloupec */
+template<class Item> bool Matrix<Item>::moveForward(const vector<itemId>& sorted, const KeyCompare& compare) {
+    if(sorted.size() == 0) return false;
 
-    /* Žádný jiný sloupec neexistuje, jsme zpět na aktuální položce */
-    if(*it == actualItem) return false;
+    Key actual = compare.key(*actualItem);
 
-    /* Hledání lepšího kandidáta v daném sloupci (x) - blíže k y než předešlý */
-    int x = (**it).x;   int y = (*actualItem).y;    actualItem = *it;
-    while(++it != sortedVertical.end() && (**it).x == x) {
+    /* První položka dalšího řádku (cyklicky) */
+    typename vector<itemId>::const_iterator first = upper_bound(sorted.begin(), sorted.end(), Key(actual.major, INT_MAX), compare);
+    if(first == sorted.end()) first = sorted.begin();
+    int line = compare.key(items[*first]).major;
 
-        /* Pokud je položka blíže aktuální než předešlý kandidát, přiřazení */
-        if( ((**it).y <= y && (*actualItem).y < (**it).y) || /* výše než aktuální */
-            ((**it).y >= y && (*actualItem).y > (**it).y)    /* níže než aktuální */
-        ) actualItem = *it;
+    /* Žádný jiný řádek neexistuje */
+    if(line == actual.major) return false;
 
-        /* Položka je dále než předešlý kandidát (už lepší nenajdeme), konec */
-        else break;
-    }
+    /* Nejbližší položka v daném řádku na pozici aktuální nebo před ní (z
+       více položek na stejné pozici ta první), pokud žádná není, první
+       položka řádku */
+    typename vector<itemId>::const_iterator it = upper_bound(sorted.begin(), sorted.end(), Key(line, actual.minor), compare);
+    if(it == first) actualItem = items.begin() + *first;
+    else actualItem = items.begin() + *lower_bound(sorted.begin(), sorted.end(), compare.key(items[*(it-1)]), compare);
 
+    damage();
     return true;
 }
 
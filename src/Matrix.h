@@ -72,6 +72,12 @@ template <class Item> class Matrix {
         /** @brief Typ pro ID položky */
         typedef typename std::vector<Item>::size_type itemId;
 
+        /** @brief Konstruktor */
+        inline Matrix(void) { actualItem = items.end(); }
+
+        /** @brief Destruktor */
+        virtual ~Matrix(void) {}
+
         /**
          * @brief Posun nahoru
          *
@@ -102,6 +108,10 @@ template <class Item> class Matrix {
 
         /**
          * @brief Zakázání položky
+         *
+         * Položku jen vyjme z řazených vektorů, aktuální položka zůstane.
+         * Pokud je zakázaná položka aktuální, aktuální bude následující
+         * položka ve vertikálním pořadí.
          * @param   item    ID položky
          * @todo Např. u klávesnice je tohle k ničemu => protected?
          */
@@ -109,6 +119,8 @@ template <class Item> class Matrix {
 
         /**
          * @brief Povolení položky
+         *
+         * Položku jen vloží do řazených vektorů, aktuální položka zůstane.
          * @param   item    ID položky
          * @todo Např. u klávesnice je tohle k ničemu => protected?
          */
@@ -122,52 +134,154 @@ template <class Item> class Matrix {
         /**
          * @brief Reload položek pro účely posunu
          *
-         * Spouštěno při přidání nové položky či při zakázání nebo povolení
-         * položky. Znova vytvoří seřazené vektory Toolbar::sortedHorizontal a
-         * Toolbar::sortedVertical z aktivních položek a první povolenou položku
-         * označí jako aktuální.
+         * Znova vytvoří seřazené vektory Matrix::sortedHorizontal a
+         * Matrix::sortedVertical z aktivních položek a první povolenou
+         * položku označí jako aktuální. Vhodné po hromadném přidání položek
+         * přímo do Matrix::items.
          */
         void reloadItems();
 
+        /**
+         * @brief Přidání položky
+         *
+         * Položku jen vloží do řazených vektorů, aktuální položka zůstane
+         * (pokud žádná není, bude aktuální přidaná položka, pokud je
+         * povolená).
+         * @param   item    Položka
+         * @return  ID položky
+         */
+        itemId insertItem(const Item& item);
+
+        /**
+         * @brief Odebrání položky
+         *
+         * ID následujících položek se sníží o jedna. Pokud je odebíraná
+         * položka aktuální, aktuální bude následující položka ve vertikálním
+         * pořadí.
+         * @param   item    ID položky
+         */
+        void removeItem(itemId item);
+
+        /**
+         * @brief Nahlášení poškozené oblasti
+         *
+         * Spouštěno při změně aktuální položky a při reloadu položek.
+         * Odvozené třídy v ní nahlásí svou oblast do Compositor.
+         */
+        virtual void damage(void) {}
+
     private:
+        /** @brief Pozice pro hledání v řazených položkách (řádek a pozice v něm) */
+        struct Key {
+            int major,              /**< @brief Řádek (sloupec) */
+                minor;              /**< @brief Pozice v řádku (sloupci) */
+
+            /** @brief Konstruktor */
+            inline Key(int _major, int _minor): major(_major), minor(_minor) {}
+        };
 
         /**
-         * @brief Vertikálně řazené ukazatele na aktivní položky
+         * @brief Porovnání položek mezi sebou a s pozicí
+         *
+         * Pro řazení a binární hledání v Matrix::sortedHorizontal (řádek je
+         * y) a Matrix::sortedVertical (řádek je x). Položky na stejné pozici
+         * jsou řazeny podle ID.
+         */
+        class KeyCompare {
+            public:
+                /**
+                 * @brief Konstruktor
+                 *
+                 * @param   _items  Položky
+                 * @param   _major  Souřadnice řádku
+                 * @param   _minor  Souřadnice pozice v řádku
+                 */
+                inline KeyCompare(const std::vector<Item>& _items, int Item::* _major, int Item::* _minor): items(&_items), major(_major), minor(_minor) {}
+
+                /** @brief Pozice položky */
+                inline Key key(const Item& item) const { return Key(item.*major, item.*minor); }
+
+                /** @brief Jestli položka patří před jinou položku */
+                inline bool operator()(itemId a, itemId b) const {
+                    const Item& first = (*items)[a];
+                    const Item& second = (*items)[b];
+                    if(first.*major != second.*major) return first.*major < second.*major;
+                    if(first.*minor != second.*minor) return first.*minor < second.*minor;
+                    return a < b;
+                }
+
+                /** @brief Jestli položka patří před pozici */
+                inline bool operator()(itemId a, const Key& b) const {
+                    const Item& item = (*items)[a];
+                    return item.*major == b.major ? item.*minor < b.minor : item.*major < b.major;
+                }
+
+                /** @brief Jestli pozice patří před položku */
+                inline bool operator()(const Key& a, itemId b) const {
+                    const Item& item = (*items)[b];
+                    return a.major == item.*major ? a.minor < item.*minor : a.major < item.*major;
+                }
+
+            private:
+                const std::vector<Item>* items;
+                int Item::* major;
+                int Item::* minor;
+        };
+
+        /**
+         * @brief Vertikálně řazená ID aktivních položek
          *
          * Pro účely horizontálního posunu - rychlé nalezení položky ve sloupci
          * vpravo či vlevo nejblíže od aktuální položky.
          */
-        typename std::vector<typename std::vector<Item>::const_iterator> sortedVertical;
+        std::vector<itemId> sortedVertical;
 
         /**
-         * @brief Horizontálně řazené ukazatele na aktivní položky
+         * @brief Horizontálně řazená ID aktivních položek
          *
          * Pro účely vertikálního posunu - rychlé nalezení položky v řádku nad
          * či pod aktuální položkou.
          */
-        typename std::vector<typename std::vector<Item>::const_iterator> sortedHorizontal;
+        std::vector<itemId> sortedHorizontal;
+
+        /** @brief Porovnání pro Matrix::sortedVertical */
+        inline KeyCompare verticalCompare(void) const { return KeyCompare(items, &Item::x, &Item::y); }
+
+        /** @brief Porovnání pro Matrix::sortedHorizontal */
+        inline KeyCompare horizontalCompare(void) const { return KeyCompare(items, &Item::y, &Item::x); }
+
+        /**
+         * @brief Vložení položky do řazených vektorů
+         *
+         * Binární hledání a vložení, bez řazení.
+         */
+        void insertSorted(itemId item);
+
+        /**
+         * @brief Vyjmutí položky z řazených vektorů
+         *
+         * Pokud je položka aktuální, aktuální bude následující položka ve
+         * vertikálním pořadí.
+         */
+        void eraseSorted(itemId item);
 
         /**
-         * @brief Predikát pro vertikální řazení položek
+         * @brief Posun na předchozí řádek (sloupec)
          *
-         * @param   a       První položka k porovnání
-         * @param   b       Druhá položka k porovnání
-         * @return  Jestli a patří před b
+         * Najde poslední položku předchozího řádku a v něm nejbližší
+         * položku k pozici aktuální. Vše binárním hledáním, tedy O(log n).
+         * @param   sorted  Seřazené položky
+         * @param   compare Porovnání pro seřazené položky
+         * @return  Zda jsme se někam pohnuli
          */
-        inline static bool verticalCompare(typename std::vector<Item>::const_iterator a, typename std::vector<Item>::const_iterator b) {
-            return (*a).x == (*b).x ? (*a).y < (*b).y : (*a).x < (*b).x;
-        }
+        bool moveBackward(const std::vector<itemId>& sorted, const KeyCompare& compare);
 
         /**
-         * @brief Predikát pro horizontální řazení položek
+         * @brief Posun na další řádek (sloupec)
          *
-         * @param   a       První položka k porovnání
-         * @param   b       Druhá položka k porovnání
-         * @return  Jestli a patří před b
+         * Viz Matrix::moveBackward.
          */
-        inline static bool horizontalCompare(typename std::vector<Item>::const_iterator a, typename std::vector<Item>::const_iterator b) {
-            return (*a).y == (*b).y ? (*a).x < (*b).x : (*a).y < (*b).y;
-        }
+        bool moveForward(const std::vector<itemId>& sorted, const KeyCompare& compare);
 };
 
 }}
@@ -17,6 +17,7 @@
 
 #include <iostream>
 
+#include "Compositor.h"
 #include "Effects.h"
 
 using namespace std;
@@ -32,6 +33,7 @@ void Menu::configureCaption (SDL_Rect* _position, Align* align, TTF_Font** font,
 
     /* Povolení ve flags */
     flags |= CAPTION;
+    layoutGeneration = 0;
 }
 
 /* Nastavení scrollbaru */
@@ -45,6 +47,7 @@ void Menu::configureScrollbar (SDL_Rect* _position, Align* align, int* arrowHeig
 
     /* Povolení ve flags */
     flags |= SCROLLBAR;
+    layoutGeneration = 0;
 }
 
 /* Vytvoření sekce menu */
@@ -83,6 +86,7 @@ int Menu::moveDown (void) {
     if(++(*actualSection).actualItem == (*actualSection).items.end())
         (*actualSection).actualItem = (*actualSection).items.begin();
 
+    damage();
     return (*(*actualSection).actualItem).flags & DISABLED ? -1 : (*(*actualSection).actualItem).action;
 }
 
@@ -93,6 +97,7 @@ int Menu::moveUp (void) {
     if((*actualSection).actualItem == (*actualSection).items.begin())
         (*actualSection).actualItem = (*actualSection).items.end();
 
+    damage();
     return (*--(*actualSection).actualItem).flags & DISABLED ? -1 : (*(*actualSection).actualItem).action;
 }
 
@@ -100,15 +105,13 @@ int Menu::moveUp (void) {
 int Menu::scrollDown (void) {
     if((*actualSection).items.size() == 0) return -1;
 
-    /* Půjčeno z Map::view() */
-    int _itemHeight = *itemHeight;
-    if(_itemHeight == 0) _itemHeight = TTF_FontLineSkip(*itemFont);
-
-    (*actualSection).actualItem += (*itemsPosition).h/_itemHeight-1;
+    updateLayout();
+    (*actualSection).actualItem += (*itemsPosition).h/lineHeight-1;
 
     if((*actualSection).actualItem > (*actualSection).items.end())
         (*actualSection).actualItem = (*actualSection).items.end()-1;
 
+    damage();
     return (*(*actualSection).actualItem).flags & DISABLED ? -1 : (*(*actualSection).actualItem).action;
 }
 
@@ -116,28 +119,28 @@ int Menu::scrollDown (void) {
 int Menu::scrollUp (void) {
     if((*actualSection).items.size() == 0) return -1;
 
-    /* Půjčeno z Map::view() */
-    int _itemHeight = *itemHeight;
-    if(_itemHeight == 0) _itemHeight = TTF_FontLineSkip(*itemFont);
-
-    (*actualSection).actualItem -= (*itemsPosition).h/_itemHeight-1;
+    updateLayout();
+    (*actualSection).actualItem -= (*itemsPosition).h/lineHeight-1;
 
     if((*actualSection).actualItem < (*actualSection).items.begin())
         (*actualSection).actualItem = (*actualSection).items.begin();
 
+    damage();
     return (*(*actualSection).actualItem).flags & DISABLED ? -1 : (*(*actualSection).actualItem).action;
 }
 
 /* Kliknutí */
 bool Menu::click(int x, int y, int& action) {
-    /* Oblast menu */
-    SDL_Rect area = Effects::align(screen, *menuAlign, *position);
+    updateLayout();
 
     /* Menu je schované nebo klik nebyl v jeho oblasti, konec */
     if(flags & HIDDEN || !inArea(x, y, area)) return false;
 
+    /* Kliknutí může změnit aktuální položku i sekci */
+    damage();
+
     /* Kliknutí na titulek - návrat do nadřazeného menu */
-    if((flags & CAPTION) && inArea(x, y, Effects::align(area, ALIGN_DEFAULT, *captionPosition))) {
+    if((flags & CAPTION) && inArea(x, y, captionArea)) {
         parentSection();
         return true;
     }
@@ -145,24 +148,21 @@ bool Menu::click(int x, int y, int& action) {
     /* Kliknutí na scrollbar */
     if((flags & SCROLLBAR)) {
         /* Kliknutí na šipku nahoru */
-        SDL_Rect temp = {(*scrollbarPosition).x, (*scrollbarPosition).y, (*scrollbarPosition).w, *scrollbarArrowHeight};
-        if(inArea(x, y, Effects::align(area, ALIGN_DEFAULT, temp))) {
+        if(inArea(x, y, arrowUpArea)) {
             scrollUp();
             return true;
         }
 
         /* Kliknutí na šipku dolů */
-        temp.y += (*scrollbarPosition).h-*scrollbarArrowHeight;
-        if(inArea(x, y, Effects::align(area, ALIGN_DEFAULT, temp))) {
+        if(inArea(x, y, arrowDownArea)) {
             scrollDown();
             return true;
         }
 
         /* Kliknutí do prostoru slideru */
-        temp.y = (*scrollbarPosition).y+(*scrollbarArrowHeight); temp.h = (*scrollbarPosition).h-2*(*scrollbarArrowHeight);
-        if((*actualSection).items.size() > 1 && inArea(x, y, (temp = Effects::align(area, ALIGN_DEFAULT, temp)))) {
+        if((*actualSection).items.size() > 1 && inArea(x, y, sliderArea)) {
             /* Spočtení pozice */
-            int position = (*actualSection).items.size()*(y - temp.y)/temp.h;
+            int position = (*actualSection).items.size()*(y - sliderArea.y)/sliderArea.h;
 
             (*actualSection).actualItem = (*actualSection).items.begin()+position;
             return true;
@@ -170,13 +170,9 @@ bool Menu::click(int x, int y, int& action) {
     }
 
     /* Kliknutí do oblasti položek */
-    if(inArea(x, y, Effects::align(area, ALIGN_DEFAULT, *itemsPosition))) {
+    if(inArea(x, y, itemsArea)) {
         /* Půjčeno z Menu::view() */
-
-        /* Mezera mezi položkami, pokud není striktně definovaná. */
-        int _itemHeight = *itemHeight;
-        if(_itemHeight == 0) _itemHeight = TTF_FontLineSkip(*itemFont);
-        int itemsPerPage = (*itemsPosition).h/_itemHeight;
+        int itemsPerPage = (*itemsPosition).h/lineHeight;
 
         /* První a poslední zobrazená položka */
         vector<Item>::const_iterator begin = (*actualSection).items.begin();
@@ -200,11 +196,10 @@ bool Menu::click(int x, int y, int& action) {
         /* Plocha pro vykreslení položek. Prvně zarování celé plochy položek, až v ní
         se podle počtu položek na stránku a vertikálního zarovnání (&0xF0) vypočítá
         konečná plocha položek */
-        SDL_Rect itemArea = Effects::align(
-            Effects::align(area, ALIGN_DEFAULT, *itemsPosition),
-            (Align) (*(*actualSection).itemsAlign & 0xF0), (*itemsPosition).w, _itemHeight*(end-begin)
+        SDL_Rect itemArea = Effects::align(itemsArea,
+            (Align) (*(*actualSection).itemsAlign & 0xF0), (*itemsPosition).w, lineHeight*(end-begin)
         );
-        itemArea.h = _itemHeight;
+        itemArea.h = lineHeight;
 
         /* Procházení položek */
         for(vector<Item>::const_iterator it = begin; it != end; ++it) {
@@ -214,7 +209,7 @@ bool Menu::click(int x, int y, int& action) {
                 return true;
             }
 
-            itemArea.y += _itemHeight;
+            itemArea.y += lineHeight;
         }
     }
 
@@ -226,6 +221,7 @@ void Menu::reloadIterators (int section) {
     /* Reloud jen u jedný sekce (při změně počtu položek menu) */
     if(section != -1) {
         sections[section].actualItem = sections[section].items.begin();
+        damage();
         return;
     }
 
@@ -235,6 +231,52 @@ void Menu::reloadIterators (int section) {
     }
 
     actualSection = sections.end()-1;
+    damage();
+}
+
+/* Poškození oblasti menu */
+void Menu::damage(void) {
+    updateLayout();
+    Compositor::damage(area);
+}
+
+/* Oblast menu */
+SDL_Rect Menu::bounds(void) {
+    updateLayout();
+    return area;
+}
+
+/* Aktualizace rozvržení */
+void Menu::updateLayout(void) {
+    if(layoutGeneration == Compositor::layoutGeneration()) return;
+    layoutGeneration = Compositor::layoutGeneration();
+
+    area = Effects::align(screen, *menuAlign, *position);
+    itemsArea = Effects::align(area, ALIGN_DEFAULT, *itemsPosition);
+
+    /* Mezera mezi položkami, pokud není striktně definovaná. */
+    lineHeight = *itemHeight;
+    if(lineHeight == 0) lineHeight = TTF_FontLineSkip(*itemFont);
+
+    if(flags & CAPTION)
+        captionArea = Effects::align(area, ALIGN_DEFAULT, *captionPosition);
+
+    if(flags & SCROLLBAR) {
+        scrollbarArea = Effects::align(area, ALIGN_DEFAULT, *scrollbarPosition);
+
+        /* Oblasti šipek a dráhy slideru pro kliknutí */
+        SDL_Rect temp = {(*scrollbarPosition).x, (*scrollbarPosition).y, (*scrollbarPosition).w, *scrollbarArrowHeight};
+        arrowUpArea = Effects::align(area, ALIGN_DEFAULT, temp);
+        temp.y += (*scrollbarPosition).h-*scrollbarArrowHeight;
+        arrowDownArea = Effects::align(area, ALIGN_DEFAULT, temp);
+        temp.y = (*scrollbarPosition).y+(*scrollbarArrowHeight); temp.h = (*scrollbarPosition).h-2*(*scrollbarArrowHeight);
+        sliderArea = Effects::align(area, ALIGN_DEFAULT, temp);
+
+        /* Pozice obrázků šipek a slideru v nejvyšším bodě */
+        arrowUpPosition = Effects::align(scrollbarArea, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_TOP), (**scrollbarArrowUp).w, (**scrollbarArrowUp).h);
+        arrowDownPosition = Effects::align(scrollbarArea, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_BOTTOM), (**scrollbarArrowDown).w, (**scrollbarArrowDown).h);
+        sliderPosition = Effects::align(scrollbarArea, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_TOP), (**scrollbarSlider).w, (**scrollbarSlider).h, 0, *scrollbarArrowHeight);
+    }
 }
 
 /* Zobrazení menu */
@@ -242,29 +284,27 @@ void Menu::view (void) {
     /* Menu je schované */
     if(flags & HIDDEN) return;
 
-    /* Plocha pro vykreslování menu */
-    SDL_Rect area = Effects::align(screen, *menuAlign, *position);
+    /* Předpočítané rozvržení */
+    updateLayout();
 
-    /* Pozadí */
-    SDL_BlitSurface(*image, NULL, screen, &area);
+    /* Pozadí (SDL_BlitSurface mění cílový obdélník při ořezu) */
+    SDL_Rect imageArea = area;
+    SDL_BlitSurface(*image, NULL, screen, &imageArea);
 
     /* Nadpisek menu */
     if(flags & CAPTION) {
         /* Prostor pro napisek */
-        SDL_Rect _captionPosition = Effects::align(area, ALIGN_DEFAULT, *captionPosition);
-        SDL_Surface* text = (*Effects::textRenderFunction())(*captionFont, (*(*actualSection).caption).c_str(), *captionColor);
+        SDL_Rect _captionPosition = captionArea;
+        int textW, textH;
+        Effects::textSize(*captionFont, *(*actualSection).caption, textW, textH);
 
         /* Přesná pozice nadpisku, ořezání a vykreslení */
-        _captionPosition = Effects::align(_captionPosition, *captionAlign, (*text).w, (*text).h);
+        _captionPosition = Effects::align(_captionPosition, *captionAlign, textW, textH);
         SDL_Rect captionCrop = {0, 0, _captionPosition.w, _captionPosition.h};
-        SDL_BlitSurface(text, &captionCrop, screen, &_captionPosition);
-        SDL_FreeSurface(text);
+        Effects::blitText(*captionFont, *(*actualSection).caption, *captionColor, &captionCrop, screen, &_captionPosition);
     }
 
-    /* Mezera mezi položkami, pokud není striktně definovaná. */
-    int _itemHeight = *itemHeight;
-    if(_itemHeight == 0) _itemHeight = TTF_FontLineSkip(*itemFont);
-    int itemsPerPage = (*itemsPosition).h/_itemHeight;
+    int itemsPerPage = (*itemsPosition).h/lineHeight;
 
     /* První a poslední zobrazená položka */
     vector<Item>::const_iterator begin = (*actualSection).items.begin();
@@ -272,19 +312,16 @@ void Menu::view (void) {
 
     /* Scrollbar */
     if(flags & SCROLLBAR) {
-        /* Prostor pro scrollbar */
-        SDL_Rect _scrollbarPosition = Effects::align(area, ALIGN_DEFAULT, *scrollbarPosition);
-
         /* Vrchní šipka, pokud je kam posouvat */
         if((*actualSection).actualItem != (*actualSection).items.begin()) {
-            SDL_Rect arrowPosition = Effects::align(_scrollbarPosition, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_TOP), (**scrollbarArrowUp).w, (**scrollbarArrowUp).h);
+            SDL_Rect arrowPosition = arrowUpPosition;
             SDL_Rect arrowCrop = {0, 0, arrowPosition.w, arrowPosition.h};
             SDL_BlitSurface(*scrollbarArrowUp, &arrowCrop, screen, &arrowPosition);
         }
 
         /* Spodní šipka, pokud je kam posouvat */
         if((*actualSection).actualItem != (*actualSection).items.end()-1) {
-            SDL_Rect arrowPosition = Effects::align(_scrollbarPosition, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_BOTTOM), (**scrollbarArrowDown).w, (**scrollbarArrowDown).h);
+            SDL_Rect arrowPosition = arrowDownPosition;
             SDL_Rect arrowCrop = {0, 0, arrowPosition.w, arrowPosition.h};
             SDL_BlitSurface(*scrollbarArrowDown, &arrowCrop, screen, &arrowPosition);
         }
@@ -292,7 +329,7 @@ void Menu::view (void) {
         /* Slider (jen při počtu položek > 1, aby se zabránilo dělení nulou) */
         if(end-begin > 1) {
             /* Pozice slideru v nejvyšším bodě */
-            SDL_Rect sliderPosition = Effects::align(_scrollbarPosition, (Align) ((*scrollbarAlign & 0x0F) | ALIGN_TOP), (**scrollbarSlider).w, (**scrollbarSlider).h, 0, *scrollbarArrowHeight);
+            SDL_Rect sliderPosition = this->sliderPosition;
 
             /* Dráha, po které může slider jet */
             int height = (*scrollbarPosition).h-2*(*scrollbarArrowHeight)-(**scrollbarSlider).h;
@@ -324,11 +361,10 @@ void Menu::view (void) {
     /* Plocha pro vykreslení položek. Prvně zarování celé plochy položek, až v ní
        se podle počtu položek na stránku a vertikálního zarovnání (&0xF0) vypočítá
        konečná plocha položek */
-    SDL_Rect itemArea = Effects::align(
-        Effects::align(area, ALIGN_DEFAULT, *itemsPosition),
-        (Align) (*(*actualSection).itemsAlign & 0xF0), (*itemsPosition).w, _itemHeight*(end-begin)
+    SDL_Rect itemArea = Effects::align(itemsArea,
+        (Align) (*(*actualSection).itemsAlign & 0xF0), (*itemsPosition).w, lineHeight*(end-begin)
     );
-    itemArea.h = _itemHeight;
+    itemArea.h = lineHeight;
 
     /* Vykreslování položek */
     for(vector<Item>::const_iterator it = begin; it != end; ++it) {
@@ -337,7 +373,7 @@ void Menu::view (void) {
         /* Ikona */
         if((*actualSection).flags & (ICONS_LEFT | ICONS_RIGHT)) {
             /* Prostor pro ikonu */
-            SDL_Rect iconPosition = {itemArea.x, itemArea.y, *iconWidth, _itemHeight};
+            SDL_Rect iconPosition = {itemArea.x, itemArea.y, *iconWidth, lineHeight};
             if((*actualSection).flags & ICONS_RIGHT) iconPosition.x = itemArea.x+itemArea.w-*iconWidth;
 
             /* Přesná pozice ikony, ořezání a vykreslení */
@@ -359,15 +395,15 @@ void Menu::view (void) {
         else if((*it).flags == DISABLED) color = disabledItemColor;
 
         /* Vykreslení oříznutého textu */
-        SDL_Surface* text = (*Effects::textRenderFunction())(*itemFont, (*(*it).caption).c_str(), *color);
-        textPosition = Effects::align(textPosition, (Align) ((*(*actualSection).itemsAlign & 0x0F) | ALIGN_MIDDLE), (*text).w, (*text).h);
+        int textW, textH;
+        Effects::textSize(*itemFont, *(*it).caption, textW, textH);
+        textPosition = Effects::align(textPosition, (Align) ((*(*actualSection).itemsAlign & 0x0F) | ALIGN_MIDDLE), textW, textH);
         SDL_Rect textCrop = {0, 0, textPosition.w, textPosition.h};
-        SDL_BlitSurface(text, &textCrop, screen, &textPosition);
-        SDL_FreeSurface(text);
+        Effects::blitText(*itemFont, *(*it).caption, *color, &textCrop, screen, &textPosition);
 
         /** @todo flags EMPTY, SEPARATOR */
 
-        itemArea.y += _itemHeight; /* Posunutí oblasti další položky */
+        itemArea.y += lineHeight; /* Posunutí oblasti další položky */
     }
 }
 
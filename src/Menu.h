@@ -26,6 +26,7 @@
 #include <SDL/SDL_ttf.h>
 
 #include "Mouse.h"
+#include "Scene.h"
 #include "utility.h"
 
 namespace Kompas { namespace Sdl {
@@ -41,7 +42,7 @@ namespace Kompas { namespace Sdl {
  * @todo Inline funkce jen tam, kde to je potřeba (kde budou často volané), zbytek
  *   přesunout do Menu.cpp
  */
-class Menu: public Mouse {
+class Menu: public Mouse, public SceneNode {
     public:
         /**
          * @brief Flags pro celé menu
@@ -104,7 +105,8 @@ class Menu: public Mouse {
             itemsPosition(_itemsPosition), itemHeight(_itemHeight), iconWidth(_iconWidth),
             itemFont(_itemFont), itemColor(_itemColor), activeItemColor(_activeItemColor),
             disabledItemColor(_disabledItemColor),
-            activeDisabledItemColor(_activeDisabledItemColor), flags(_flags) {}
+            activeDisabledItemColor(_activeDisabledItemColor), flags(_flags),
+            layoutGeneration(0) {}
 
         /**
          * @brief Nastavení nadpisku
@@ -175,6 +177,7 @@ class Menu: public Mouse {
          */
         inline void disableItem(sectionId section, itemId item) {
             sections[section].items[item].flags |= DISABLED;
+            damage();
         }
 
         /** @brief Povolení položky menu
@@ -184,6 +187,7 @@ class Menu: public Mouse {
          */
         inline void enableItem(sectionId section, itemId item) {
             sections[section].items[item].flags &= ~DISABLED;
+            damage();
         }
 
         /**
@@ -209,7 +213,7 @@ class Menu: public Mouse {
          */
         inline bool changeSection(sectionId section) {
             if(actualSection == sections.begin()+section) return false;
-            actualSection = sections.begin()+section; return true;
+            actualSection = sections.begin()+section; damage(); return true;
         }
 
         /**
@@ -219,7 +223,7 @@ class Menu: public Mouse {
          */
         inline bool parentSection(void) {
             if(actualSection == sections.begin()+(*actualSection).parent) return false;
-            actualSection = sections.begin()+(*actualSection).parent; return true;
+            actualSection = sections.begin()+(*actualSection).parent; damage(); return true;
         }
 
         /**
@@ -264,10 +268,10 @@ class Menu: public Mouse {
         bool click(int x, int y, int& action);
 
         /** @brief Schování menu */
-        inline void hide(void) { flags |= HIDDEN; }
+        inline void hide(void) { flags |= HIDDEN; damage(); }
 
         /** @brief Povolení zobrazení menu */
-        inline void show(void) { flags &= ~HIDDEN; }
+        inline void show(void) { flags &= ~HIDDEN; damage(); }
 
         /** @brief Zjištění, jestli je povoleno zobrazení menu */
         inline operator bool(void) { return !(flags & HIDDEN); }
@@ -275,6 +279,12 @@ class Menu: public Mouse {
         /** @brief Zobrazení menu */
         void view(void);
 
+        /** @brief Oblast menu */
+        SDL_Rect bounds(void);
+
+        /** @brief Zda není menu schované */
+        inline bool isVisible(void) const { return !(flags & HIDDEN); }
+
     private:
         /** @brief Struktura položky menu */
         struct Item {
@@ -334,6 +344,31 @@ class Menu: public Mouse {
          *  obnoví iterátory ve všech sekcích + ukazatel na aktuální sekci
          */
         void reloadIterators(int section = -1);
+
+        /** @brief Nahlášení oblasti menu jako poškozené */
+        void damage(void);
+
+        unsigned int layoutGeneration;  /**< @brief Generace rozvržení (0, pokud je potřeba přepočítat) */
+        SDL_Rect area;              /**< @brief Oblast menu */
+        SDL_Rect captionArea;       /**< @brief Oblast nadpisku */
+        SDL_Rect itemsArea;         /**< @brief Oblast položek */
+        int lineHeight;             /**< @brief Výška položky (i autodetekovaná) */
+        SDL_Rect scrollbarArea,     /**< @brief Oblast scrollbaru */
+            arrowUpArea,            /**< @brief Oblast horní šipky (pro kliknutí) */
+            arrowDownArea,          /**< @brief Oblast spodní šipky (pro kliknutí) */
+            sliderArea,             /**< @brief Dráha slideru (pro kliknutí) */
+            arrowUpPosition,        /**< @brief Pozice obrázku horní šipky */
+            arrowDownPosition,      /**< @brief Pozice obrázku spodní šipky */
+            sliderPosition;         /**< @brief Pozice slideru v nejvyšším bodě */
+
+        /**
+         * @brief Aktualizace rozvržení
+         *
+         * Přepočítá oblasti menu, nadpisku, scrollbaru a položek, pokud se
+         * změnila generace rozvržení (viz Compositor::layoutGeneration) nebo
+         * nastavení menu.
+         */
+        void updateLayout(void);
 };
 
 }}
@@ -15,14 +15,67 @@
 
 #include "Mouse.h"
 
+using namespace std;
+
 namespace Kompas { namespace Sdl {
 
 /* Zjištění, zda byl klik v oblasti */
-bool Mouse::inArea(int x, int y, const SDL_Rect& area) {
+bool Mouse::inArea(int x, int y, const SDL_Rect& area) const {
     if((x >= area.x && x < area.x+area.w) &&
        (y >= area.y && y < area.y+area.h))
         return true;
     return false;
 }
 
+/* Začátek sestavování indexu */
+void Mouse::clearHitTargets(const SDL_Rect& area) {
+    hitWidth = area.w;
+    hitHeight = area.h;
+    hitColumns = (hitWidth+HIT_CELL_SIZE-1)/HIT_CELL_SIZE;
+    hitRows = (hitHeight+HIT_CELL_SIZE-1)/HIT_CELL_SIZE;
+
+    hitTargets.clear();
+    hitCells.clear();
+    hitCells.resize(hitColumns*hitRows);
+    hitTestValid = true;
+}
+
+/* Přidání položky do indexu */
+void Mouse::addHitTarget(const SDL_Rect& area, int id) {
+    HitTarget target;
+    target.area = area;
+    target.id = id;
+    hitTargets.push_back(target);
+
+    /* Buňky, do kterých položka zasahuje (jen v rámci oblasti objektu) */
+    int left = area.x < 0 ? 0 : area.x/HIT_CELL_SIZE;
+    int top = area.y < 0 ? 0 : area.y/HIT_CELL_SIZE;
+    int right = (area.x+area.w-1)/HIT_CELL_SIZE;
+    int bottom = (area.y+area.h-1)/HIT_CELL_SIZE;
+    if(area.w == 0 || area.h == 0 || area.x+area.w <= 0 || area.y+area.h <= 0) return;
+    if(right >= hitColumns) right = hitColumns-1;
+    if(bottom >= hitRows) bottom = hitRows-1;
+
+    for(int row = top; row <= bottom; ++row)
+        for(int column = left; column <= right; ++column)
+            hitCells[row*hitColumns+column].push_back(hitTargets.size()-1);
+}
+
+/* Nalezení položky pod kurzorem */
+int Mouse::hitTest(const SDL_Rect& area, int x, int y) const {
+    x -= area.x;
+    y -= area.y;
+    if(x < 0 || y < 0 || x >= hitWidth || y >= hitHeight) return -1;
+
+    /* Položky v buňce jsou v pořadí přidání */
+    const vector<unsigned int>& cell = hitCells[(y/HIT_CELL_SIZE)*hitColumns+x/HIT_CELL_SIZE];
+    for(vector<unsigned int>::const_iterator it = cell.begin(); it != cell.end(); ++it) {
+        const HitTarget& target = hitTargets[*it];
+        if(inArea(x, y, target.area) && hitTargetEnabled(target.id))
+            return target.id;
+    }
+
+    return -1;
+}
+
 }}
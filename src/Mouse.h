@@ -20,6 +20,7 @@
  * @brief Třída Mouse
  */
 
+#include <vector>
 #include <SDL/SDL.h>
 
 namespace Kompas { namespace Sdl {
@@ -29,6 +30,12 @@ namespace Kompas { namespace Sdl {
  *
  * Od tohoto základu se odvozují třídy umožňující ovládání pomocí myši a
  * reimplementují funkce Mouse::click, Mouse::mouseDown a Mouse::mouseUp.
+ *
+ * Pro rychlé nalezení položky pod kurzorem mají odvozené třídy k dispozici
+ * index (rovnoměrnou mřížku) s oblastmi položek relativně k oblasti objektu.
+ * Index se sestavuje jen při změně velikosti oblasti objektu nebo po
+ * zneplatnění pomocí Mouse::invalidateHitTest, nalezení položky je pak O(1)
+ * nezávisle na jejich počtu.
  */
 class Mouse {
     public:
@@ -67,7 +74,21 @@ class Mouse {
          * @return  Zda bylo klinutí v oblasti objektu
          */
         virtual bool mouseUp(int x, int y, int& action) { return false; }
+
+        /** @brief Destruktor */
+        virtual ~Mouse(void) {}
+
+        /**
+         * @brief Zneplatnění indexu položek
+         *
+         * Volat při změně oblastí položek (např. po znovunačtení skinu),
+         * index se znovu sestaví při dalším kliknutí.
+         */
+        inline void invalidateHitTest(void) { hitTestValid = false; }
+
     protected:
+        /** @brief Konstruktor */
+        inline Mouse(void): hitTestValid(false), hitWidth(0), hitHeight(0), hitColumns(0), hitRows(0) {}
 
         /**
          * @brief Zjištění, zda bylo kliknutí v oblasti
@@ -77,7 +98,72 @@ class Mouse {
          * @param   area    Oblast
          * @return  Zda bylo klinutí v oblasti
          */
-        bool inArea(int x, int y, const SDL_Rect& area);
+        bool inArea(int x, int y, const SDL_Rect& area) const;
+
+        /**
+         * @brief Zda je potřeba znovu sestavit index položek
+         *
+         * @param   area    Aktuální oblast objektu
+         */
+        inline bool hitTestOutdated(const SDL_Rect& area) const {
+            return !hitTestValid || area.w != hitWidth || area.h != hitHeight;
+        }
+
+        /**
+         * @brief Začátek sestavování indexu položek
+         *
+         * Smaže všechny položky z indexu.
+         * @param   area    Oblast objektu
+         */
+        void clearHitTargets(const SDL_Rect& area);
+
+        /**
+         * @brief Přidání položky do indexu
+         *
+         * Při překrývání položek má přednost ta přidaná dříve.
+         * @param   area    Oblast položky relativně k oblasti objektu
+         * @param   id      ID položky
+         */
+        void addHitTarget(const SDL_Rect& area, int id);
+
+        /**
+         * @brief Nalezení položky pod kurzorem
+         *
+         * @param   area    Oblast objektu
+         * @param   x       X-ová souřadnice
+         * @param   y       Y-ová souřadnice
+         * @return  ID položky, pro kterou Mouse::hitTargetEnabled vrací true,
+         *  -1, pokud žádná taková není
+         */
+        int hitTest(const SDL_Rect& area, int x, int y) const;
+
+        /**
+         * @brief Zda lze na položku kliknout
+         *
+         * Zde mohou odvozené třídy vyřadit např. zakázané položky, aby se
+         * kvůli nim nemusel index sestavovat znovu.
+         */
+        virtual bool hitTargetEnabled(int id) const { return true; }
+
+    private:
+        /** @brief Položka v indexu */
+        struct HitTarget {
+            SDL_Rect area;          /**< @brief Oblast relativně k oblasti objektu */
+            int id;                 /**< @brief ID položky */
+        };
+
+        /** @brief Velikost buňky indexu (v pixelech) */
+        static const int HIT_CELL_SIZE = 16;
+
+        bool hitTestValid;          /**< @brief Zda je index platný */
+        int hitWidth,               /**< @brief Šířka oblasti, pro kterou je index sestaven */
+            hitHeight,              /**< @brief Výška oblasti, pro kterou je index sestaven */
+            hitColumns,             /**< @brief Počet sloupců buněk */
+            hitRows;                /**< @brief Počet řádků buněk */
+        std::vector<HitTarget> hitTargets; /**< @brief Položky v indexu */
+
+        /** @brief Indexy do Mouse::hitTargets pro každou buňku (po řádcích) */
+        std::vector<std::vector<unsigned int> > hitCells;
 };
 
 }}
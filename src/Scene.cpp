@@ -0,0 +1,117 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "Scene.h"
+
+#include <algorithm>    /* min(), max() */
+
+#include "Compositor.h"
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+/* Přidání uzlu */
+void Scene::add(SceneNode* node, int z) {
+    Entry entry;
+    entry.node = node;
+    entry.z = z;
+
+    /* Vložení za poslední uzel se stejnou nebo menší výškou */
+    vector<Entry>::iterator it = nodes.begin();
+    while(it != nodes.end() && (*it).z <= z) ++it;
+    nodes.insert(it, entry);
+
+    Compositor::damage((*node).bounds());
+}
+
+/* Odebrání uzlu */
+void Scene::remove(SceneNode* node) {
+    for(vector<Entry>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if((*it).node != node) continue;
+
+        Compositor::damage((*node).bounds());
+        nodes.erase(it);
+        return;
+    }
+}
+
+/* Vykreslení poškozených oblastí */
+void Scene::render(SDL_Surface* screen) {
+    if(!Compositor::damaged()) return;
+
+    vector<SDL_Rect> areas = Compositor::merge(screen);
+    Compositor::clear();
+
+    /* Viditelné uzly a jejich oblasti, zjistí se jen jednou pro všechny
+       překreslované oblasti */
+    vector<SceneNode*> visible;
+    vector<SDL_Rect> bounds;
+    for(vector<Entry>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if(!(*(*it).node).isVisible()) {
+            _culled += areas.size();
+            continue;
+        }
+
+        visible.push_back((*it).node);
+        bounds.push_back((*(*it).node).bounds());
+    }
+
+    for(vector<SDL_Rect>::const_iterator area = areas.begin(); area != areas.end(); ++area) {
+        /* Nejvyšší neprůhledný uzel pokrývající celou oblast, uzly pod ním
+           není potřeba kreslit */
+        vector<SceneNode*>::size_type first = visible.size();
+        while(first != 0) {
+            --first;
+            if((*visible[first]).isOpaque() && contains(bounds[first], *area)) break;
+        }
+        _culled += first;
+
+        for(vector<SceneNode*>::size_type i = first; i != visible.size(); ++i) {
+            /* Uzel mimo oblast */
+            SDL_Rect clip = intersect(*area, bounds[i]);
+            if(clip.w == 0 || clip.h == 0) {
+                ++_culled;
+                continue;
+            }
+
+            SDL_SetClipRect(screen, &clip);
+            (*visible[i]).view();
+            ++_drawn;
+        }
+    }
+    SDL_SetClipRect(screen, NULL);
+
+    if(!areas.empty()) SDL_UpdateRects(screen, areas.size(), &areas[0]);
+}
+
+/* Průnik obdélníků */
+SDL_Rect Scene::intersect(const SDL_Rect& a, const SDL_Rect& b) {
+    int left = max(a.x, b.x), top = max(a.y, b.y),
+        right = min(a.x+a.w, b.x+b.w), bottom = min(a.y+a.h, b.y+b.h);
+
+    SDL_Rect rect = {0, 0, 0, 0};
+    if(left >= right || top >= bottom) return rect;
+
+    rect.x = left; rect.y = top; rect.w = right-left; rect.h = bottom-top;
+    return rect;
+}
+
+/* Obsažení obdélníku */
+bool Scene::contains(const SDL_Rect& a, const SDL_Rect& b) {
+    return b.x >= a.x && b.y >= a.y && b.x+b.w <= a.x+a.w && b.y+b.h <= a.y+a.h;
+}
+
+}}
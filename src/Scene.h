@@ -0,0 +1,129 @@
+#ifndef Kompas_Sdl_Scene_h
+#define Kompas_Sdl_Scene_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/**
+ * @file Scene.h
+ * @brief Třídy SceneNode a Scene
+ */
+
+#include <vector>
+#include <SDL/SDL.h>
+
+namespace Kompas { namespace Sdl {
+
+/**
+ * @brief Uzel scény
+ *
+ * Od tohoto základu se odvozují vykreslované objekty (splash, mapa,
+ * toolbar...). Každý uzel je skupina s ořezem: kreslí jen do své oblasti
+ * (viz SceneNode::bounds), Scene před voláním SceneNode::view nastaví
+ * ořezový obdélník na průnik oblasti uzlu a překreslované oblasti.
+ */
+class SceneNode {
+    public:
+        /** @brief Destruktor */
+        virtual ~SceneNode(void) {}
+
+        /**
+         * @brief Zobrazení uzlu
+         *
+         * Kreslí jen do ořezového obdélníku displejové surface.
+         */
+        virtual void view(void) = 0;
+
+        /**
+         * @brief Oblast uzlu
+         *
+         * Uzel nesmí kreslit mimo ni.
+         */
+        virtual SDL_Rect bounds(void) = 0;
+
+        /** @brief Zda je uzel viditelný */
+        virtual bool isVisible(void) const { return true; }
+
+        /**
+         * @brief Zda je uzel neprůhledný
+         *
+         * Neprůhledný uzel pokrývá celou svou oblast, uzly pod ním se v
+         * oblastech, které celé pokrývá, nevykreslují.
+         */
+        virtual bool isOpaque(void) const { return false; }
+};
+
+/**
+ * @brief Scéna
+ *
+ * Uzly se registrují funkcí Scene::add se svou výškou (z-order). Funkce
+ * Scene::render převezme poškozené oblasti od Compositor a v každé z nich
+ * vykreslí uzly odspodu nahoru. Přeskočí přitom skryté uzly, uzly mimo
+ * danou oblast a uzly zakryté neprůhledným uzlem, který oblast celou
+ * pokrývá (např. splash pod načtenou mapou). Všechny oblasti se pak pošlou
+ * na displej jedním voláním SDL_UpdateRects.
+ */
+class Scene {
+    public:
+        /** @brief Konstruktor */
+        inline Scene(void): _drawn(0), _culled(0) {}
+
+        /**
+         * @brief Přidání uzlu
+         *
+         * @param   node    Uzel
+         * @param   z       Výška uzlu, uzly s větší výškou se kreslí navrch.
+         *  Uzly se stejnou výškou se kreslí v pořadí přidání.
+         */
+        void add(SceneNode* node, int z);
+
+        /** @brief Odebrání uzlu */
+        void remove(SceneNode* node);
+
+        /**
+         * @brief Vykreslení poškozených oblastí
+         *
+         * Oblasti se vymažou ještě před vykreslením, aby poškození nahlášené
+         * během vykreslování vydrželo do dalšího snímku.
+         * @param   screen  Displejová surface
+         */
+        void render(SDL_Surface* screen);
+
+        /** @brief Počet vykreslení uzlů */
+        inline unsigned int drawnCount(void) const { return _drawn; }
+
+        /** @brief Počet přeskočených (skrytých, zakrytých nebo mimo oblast) vykreslení uzlů */
+        inline unsigned int culledCount(void) const { return _culled; }
+
+    private:
+        /** @brief Registrovaný uzel */
+        struct Entry {
+            SceneNode* node;    /**< @brief Uzel */
+            int z;              /**< @brief Výška */
+        };
+
+        std::vector<Entry> nodes;   /**< @brief Uzly seřazené odspodu nahoru */
+        unsigned int _drawn,        /**< @brief Počet vykreslení uzlů */
+            _culled;                /**< @brief Počet přeskočených vykreslení */
+
+        /** @brief Průnik obdélníků (nulová velikost, pokud se nepřekrývají) */
+        static SDL_Rect intersect(const SDL_Rect& a, const SDL_Rect& b);
+
+        /** @brief Zda obdélník @c a celý obsahuje obdélník @c b */
+        static bool contains(const SDL_Rect& a, const SDL_Rect& b);
+};
+
+}}
+
+#endif
@@ -15,28 +15,89 @@
 
 #include "Skin.h"
 
+#include <algorithm>
+#include <climits>      /* PATH_MAX */
+#include <cstdlib>      /* realpath(), _fullpath() */
+#include <cstring>      /* memcpy() */
 #include <iostream>
+#include <set>
+#include <sys/stat.h>
 #include <SDL/SDL_image.h>
 
+#ifdef HAVE_INOTIFY
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Compositor.h"
 #include "Effects.h"
 
 using namespace std;
 
 namespace Kompas { namespace Sdl {
 
+bool Skin::lazy = false;
+
+/* Řazení obrázků podle výšky (od nejvyššího) */
+static bool higherImage(const SDL_Surface* a, const SDL_Surface* b) {
+    return (*a).h > (*b).h;
+}
+
+/* Konstruktor */
+Skin::Skin(SDL_Surface* _screen, const string& file, unsigned int loaderThreads): screen(_screen), quit(false), pending(0), warming(false), deferring(lazy), repack(false), watcher(-1) {
+    /* Průhledný obrázek pro odložené obrázky */
+    placeholder = SDL_CreateRGBSurface(SDL_SWSURFACE|SDL_SRCALPHA, 1, 1, 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+    SDL_FillRect(placeholder, NULL, 0);
+
+    mutex = SDL_CreateMutex();
+    requested = SDL_CreateCond();
+    decoded = SDL_CreateCond();
+
+    for(unsigned int i = 0; i != loaderThreads; ++i) {
+        SDL_Thread* thread = SDL_CreateThread(worker, this);
+        if(thread == NULL) {
+            cerr << "Nelze vytvořit vlákno pro načítání skinu: " << SDL_GetError() << endl;
+            continue;
+        }
+        workers.push_back(thread);
+    }
+
+    load(file);
+}
+
 /* Destruktor */
 Skin::~Skin(void) {
-    /* Uvolnění surfaců a ukazatelů na ně */
-    for(vector<Skin::Property<SDL_Surface**> >::iterator it = surfaces.begin(); it != surfaces.end(); ++it) {
-        if((*(*it).property) != NULL) SDL_FreeSurface((*(*it).property));
+    /* Ukončení vláken, uvolnění obrázků, které už nikdo nepřevezme */
+    SDL_LockMutex(mutex);
+    quit = true;
+    SDL_CondBroadcast(requested);
+    SDL_UnlockMutex(mutex);
+
+    for(vector<SDL_Thread*>::const_iterator it = workers.begin(); it != workers.end(); ++it)
+        SDL_WaitThread(*it, NULL);
+
+    for(vector<Job>::const_iterator it = done.begin(); it != done.end(); ++it)
+        if((*it).image != NULL) SDL_FreeSurface((*it).image);
+
+    /* Uvolnění sdílených obrázků a fontů (a glyphů a textů fontů v cache) */
+    Effects::clearTextCache();
+    releaseAssets();
+    SDL_FreeSurface(placeholder);
+
+    watch(false);
+
+    SDL_DestroyCond(decoded);
+    SDL_DestroyCond(requested);
+    SDL_DestroyMutex(mutex);
+
+    /* Smazání ukazatelů na surface */
+    for(vector<Skin::Property<SDL_Surface**> >::iterator it = surfaces.begin(); it != surfaces.end(); ++it)
         delete (*it).property;
-    }
 
-    /* Uvolnění fontů a ukazatelů na ně */
-    for(vector<Skin::Property<TTF_Font**> >::iterator it = fonts.begin(); it != fonts.end(); ++it) {
-        if((*(*it).property) != NULL) TTF_CloseFont((*(*it).property));
+    /* Smazání ukazatelů na fonty */
+    for(vector<Skin::Property<TTF_Font**> >::iterator it = fonts.begin(); it != fonts.end(); ++it)
         delete (*it).property;
-    }
 
     /* Smazání ukazatelů na texty */
     for(vector<Skin::Property<string*> >::iterator it = texts.begin(); it != texts.end(); ++it)
@@ -57,44 +118,52 @@ Skin::~Skin(void) {
 
 /* Načtení skinu */
 void Skin::load (const string& file) {
+    /* Dokončení případného rozdělaného načítání, aby nic nezůstalo viset */
+    finishLoading();
+
+    skinFile = file;
     conf = ConfParser(file);
 
     /* Vyplnění černou barvou, aby nezůstávaly artefakty */
     SDL_FillRect(screen, NULL, SDL_MapRGB((*screen).format, 0, 0, 0));
 
-    /* Načtení surfaců z nového skinu */
+    /* Obrázky a fonty, které nový skin používá */
+    set<string> usedImages;
     for(vector<Skin::Property<SDL_Surface**> >::iterator it = surfaces.begin(); it != surfaces.end(); ++it) {
-        /* Uvolnění starého PŘED načtením nového, aby nevznikla neúnosná špička obsazení paměti */
-        if((*(*it).property) != NULL) SDL_FreeSurface((*(*it).property));
-
         string file;
         conf.value((*it).parameter, file, conf.section((*it).section));
+        usedImages.insert(resolvePath(file));
+    }
+    set<pair<string, int> > usedFonts;
+    for(vector<Skin::Property<TTF_Font**> >::iterator it = fonts.begin(); it != fonts.end(); ++it) {
+        string file;
+        conf.value((*it).parameter, file, conf.section((*it).section));
+        int fontSize = 0;
+        conf.value((*it).parameter + "Size", fontSize, conf.section((*it).section));
+        usedFonts.insert(pair<string, int>(resolvePath(file), fontSize));
+    }
 
-        /* Konverze do formátu displeje */
-        SDL_Surface* temp = IMG_Load(file.c_str());
-        if(temp == NULL) {
-            cerr << "Nepodařilo se načíst obrázek '" << file << "'." << endl;
-            *(*it).property = NULL;
-        }
-        else {
-            *(*it).property = SDL_DisplayFormatAlpha(temp);
-            SDL_FreeSurface(temp);
-        }
+    /* Uvolnění obrázků a fontů, které se změnily nebo už nejsou potřeba,
+       PŘED načtením nových, aby nevznikla neúnosná špička obsazení paměti.
+       Nezměněné zůstanou načtené. */
+    releaseUnused(usedImages, usedFonts);
+    changedFiles.clear();
+
+    /* Načtení surfaců z nového skinu (dekódují se na pozadí, zatímco se
+       načítají fonty a ostatní věci, už načtené se jen přiřadí) */
+    for(vector<Skin::Property<SDL_Surface**> >::iterator it = surfaces.begin(); it != surfaces.end(); ++it) {
+        string file;
+        conf.value((*it).parameter, file, conf.section((*it).section));
+        acquireImage(file, (*it).property);
     }
 
     /* Načtení fontů z nového skinu */
     for(vector<Skin::Property<TTF_Font**> >::iterator it = fonts.begin(); it != fonts.end(); ++it) {
-        /* Uvolnění starého PŘED načtením nového, aby nevznikla neúnosná špička obsazení paměti */
-        if((*(*it).property) != NULL) TTF_CloseFont((*(*it).property));
-
         string file;
         conf.value((*it).parameter, file, conf.section((*it).section));
         int fontSize = 0;
         conf.value((*it).parameter + "Size", fontSize, conf.section((*it).section));
-
-        (*(*it).property) = TTF_OpenFont(file.c_str(), fontSize);
-        if(*(*it).property == NULL)
-            cerr << "Nepodařilo se načíst font '" << file << "'." << endl;
+        acquireFont(file, fontSize, (*it).property);
     }
 
     /* Načtení textů z nového skinu */
@@ -124,6 +193,542 @@ void Skin::load (const string& file) {
         (*(*it).property) = (Align) 0; /* reset, aby nedocházelo k nedefinovaným jevům */
         conf.value((*it).parameter, (*(*it).property), conf.section((*it).section));
     }
+
+    /* Počkání na obrázky */
+    finishLoading();
+
+    /* Sledování souborů nového skinu */
+    if(watcher != -1) addWatches();
+
+    /* Nový skin, nové rozvržení a překreslení celé obrazovky */
+    Compositor::invalidateLayout();
+}
+
+/* Zapnutí / vypnutí sledování změn skinu */
+bool Skin::watch(bool enabled) {
+    #ifdef HAVE_INOTIFY
+    if(watcher != -1) {
+        close(watcher);
+        watcher = -1;
+        watched.clear();
+        watchedFiles.clear();
+    }
+    if(!enabled) return true;
+
+    watcher = inotify_init();
+    if(watcher == -1) return false;
+    fcntl(watcher, F_SETFL, fcntl(watcher, F_GETFL) | O_NONBLOCK);
+
+    addWatches();
+    return true;
+    #else
+    return !enabled;
+    #endif
+}
+
+/* Přidání sledovaných souborů */
+void Skin::addWatches(void) {
+    #ifdef HAVE_INOTIFY
+    watchedFiles.clear();
+    watchedFiles.insert(resolvePath(skinFile));
+    for(map<string, SharedImage>::const_iterator it = images.begin(); it != images.end(); ++it)
+        watchedFiles.insert(it->first);
+    for(map<pair<string, int>, SharedFont>::const_iterator it = loadedFonts.begin(); it != loadedFonts.end(); ++it)
+        watchedFiles.insert(it->first.first);
+
+    /* Sledují se adresáře, protože editory často soubor při uložení
+       nahradí jiným. Opětovné přidání adresáře vrátí stejný deskriptor. */
+    for(set<string>::const_iterator it = watchedFiles.begin(); it != watchedFiles.end(); ++it) {
+        string directory = it->substr(0, it->rfind('/'));
+        if(directory.empty()) directory = ".";
+        int descriptor = inotify_add_watch(watcher, directory.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO);
+        if(descriptor != -1) watched[descriptor] = directory;
+    }
+    #endif
+}
+
+/* Znovunačtení změněného skinu */
+bool Skin::reloadChanged(void) {
+    #ifdef HAVE_INOTIFY
+    if(watcher == -1) return false;
+
+    /* Přečtení všech událostí, zda se týkají souborů skinu (ne např.
+       dočasných souborů editorů nebo cache konfiguráku) */
+    char buffer[4096];
+    ssize_t length;
+    while((length = read(watcher, buffer, sizeof(buffer))) > 0) {
+        for(ssize_t i = 0; i < length; ) {
+            const inotify_event& event = *reinterpret_cast<const inotify_event*>(buffer+i);
+            i += sizeof(inotify_event) + event.len;
+            if(event.len == 0) continue;
+
+            map<int, string>::const_iterator directory = watched.find(event.wd);
+            if(directory == watched.end()) continue;
+
+            string file = directory->second + '/' + event.name;
+            if(watchedFiles.find(file) != watchedFiles.end())
+                changedFiles.insert(file);
+        }
+    }
+
+    if(changedFiles.empty()) return false;
+    load(skinFile);
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+/* Čas poslední změny souboru */
+time_t Skin::modificationTime(const string& file) {
+    struct stat info;
+    if(stat(file.c_str(), &info) != 0) return 0;
+    return info.st_mtime;
+}
+
+/* Získání obrázku */
+void Skin::acquireImage(const string& file, SDL_Surface** surface) {
+    string path = resolvePath(file);
+
+    /* Už načtený nebo načítaný obrázek, jen přidání ukazatele (pokud se
+       ještě dekóduje, nastaví se ve Skin::finishLoading) */
+    map<string, SharedImage>::iterator found = images.find(path);
+    if(found != images.end()) {
+        found->second.users.push_back(surface);
+        *surface = found->second.deferred ? placeholder : found->second.image;
+        return;
+    }
+
+    SharedImage& image = images[path];
+    image.file = file;
+    image.modified = modificationTime(path);
+    image.image = NULL;
+    image.deferred = deferring;
+    image.packed = false;
+    image.users.push_back(surface);
+
+    /* V líném režimu jen zapamatování, dekóduje se až při vyžádání */
+    if(deferring) *surface = placeholder;
+    else {
+        *surface = NULL;
+        request(path);
+    }
+}
+
+/* Vyžádání obrázků ze sekce */
+void Skin::require(const string& section) {
+    for(vector<Skin::Property<SDL_Surface**> >::const_iterator it = surfaces.begin(); it != surfaces.end(); ++it) {
+        if((*it).section != section) continue;
+
+        string file;
+        conf.value((*it).parameter, file, conf.section((*it).section));
+        map<string, SharedImage>::iterator found = images.find(resolvePath(file));
+        if(found == images.end() || !found->second.deferred) continue;
+
+        found->second.deferred = false;
+        request(found->first);
+    }
+}
+
+/* Dekódování odložených obrázků na pozadí */
+void Skin::warmUp(void) {
+    deferring = false;
+
+    SDL_LockMutex(mutex);
+    warming = true;
+    SDL_UnlockMutex(mutex);
+
+    for(map<string, SharedImage>::iterator it = images.begin(); it != images.end(); ++it) {
+        if(!it->second.deferred) continue;
+
+        it->second.deferred = false;
+        request(it->first);
+    }
+}
+
+/* Převzetí obrázků dekódovaných na pozadí */
+void Skin::update(void) {
+    bool converted = false;
+
+    SDL_LockMutex(mutex);
+    while(!done.empty()) {
+        Job job = done.back();
+        done.pop_back();
+
+        SDL_UnlockMutex(mutex);
+        convert(job);
+        SDL_LockMutex(mutex);
+
+        --pending;
+        converted = true;
+    }
+    if(pending == 0) warming = false;
+    bool finished = pending == 0;
+    SDL_UnlockMutex(mutex);
+
+    if(!converted) return;
+
+    /* Přebalení atlasů až po dekódování všeho, aby se nebalilo pořád */
+    if(finished && repack) {
+        pack();
+        repack = false;
+    }
+
+    /* Nové obrázky mohou mít jiné rozměry, nové rozvržení a překreslení všeho */
+    Compositor::invalidateLayout();
+}
+
+/* Získání fontu */
+void Skin::acquireFont(const string& file, int size, TTF_Font** font) {
+    pair<string, int> key(resolvePath(file), size);
+
+    /* Už načtený font */
+    map<pair<string, int>, SharedFont>::iterator found = loadedFonts.find(key);
+    if(found != loadedFonts.end()) {
+        found->second.users.push_back(font);
+        *font = found->second.font;
+        return;
+    }
+
+    SharedFont& shared = loadedFonts[key];
+    shared.modified = modificationTime(key.first);
+    shared.font = TTF_OpenFont(file.c_str(), size);
+    if(shared.font == NULL)
+        cerr << "Nepodařilo se načíst font '" << file << "'." << endl;
+    shared.users.push_back(font);
+    *font = shared.font;
+}
+
+/* Uvolnění změněných a nepoužívaných obrázků a fontů */
+void Skin::releaseUnused(const set<string>& usedImages, const set<pair<string, int> >& usedFonts) {
+    for(map<string, SharedImage>::iterator it = images.begin(); it != images.end(); ) {
+        SharedImage& image = it->second;
+
+        /* Nezměněný obrázek zůstane, ukazatele se přiřadí znovu */
+        if(image.image != NULL && usedImages.find(it->first) != usedImages.end() &&
+           changedFiles.find(it->first) == changedFiles.end() && image.modified == modificationTime(it->first)) {
+            image.users.clear();
+            ++it;
+            continue;
+        }
+
+        if(image.image != NULL) SDL_FreeSurface(image.image);
+        for(vector<SDL_Surface**>::const_iterator user = image.users.begin(); user != image.users.end(); ++user)
+            **user = NULL;
+        images.erase(it++);
+
+        /* V atlasu zůstalo volné místo */
+        repack = true;
+    }
+
+    bool fontsChanged = false;
+    for(map<pair<string, int>, SharedFont>::iterator it = loadedFonts.begin(); it != loadedFonts.end(); ) {
+        SharedFont& font = it->second;
+
+        /* Nezměněný font zůstane, ukazatele se přiřadí znovu */
+        if(font.font != NULL && usedFonts.find(it->first) != usedFonts.end() &&
+           changedFiles.find(it->first.first) == changedFiles.end() && font.modified == modificationTime(it->first.first)) {
+            font.users.clear();
+            ++it;
+            continue;
+        }
+
+        /* Glyphy a texty starých fontů v cache už nebudou platné */
+        if(!fontsChanged) {
+            Effects::clearTextCache();
+            fontsChanged = true;
+        }
+
+        if(font.font != NULL) TTF_CloseFont(font.font);
+        for(vector<TTF_Font**>::const_iterator user = font.users.begin(); user != font.users.end(); ++user)
+            **user = NULL;
+        loadedFonts.erase(it++);
+    }
+}
+
+/* Uvolnění všech obrázků a fontů */
+void Skin::releaseAssets(void) {
+    for(map<string, SharedImage>::iterator it = images.begin(); it != images.end(); ++it) {
+        if(it->second.image != NULL) SDL_FreeSurface(it->second.image);
+        for(vector<SDL_Surface**>::const_iterator user = it->second.users.begin(); user != it->second.users.end(); ++user)
+            **user = NULL;
+    }
+    images.clear();
+
+    /* Atlasy až po obrázcích, které do nich ukazují */
+    for(vector<SDL_Surface*>::const_iterator it = atlases.begin(); it != atlases.end(); ++it)
+        SDL_FreeSurface(*it);
+    atlases.clear();
+
+    for(map<pair<string, int>, SharedFont>::iterator it = loadedFonts.begin(); it != loadedFonts.end(); ++it) {
+        if(it->second.font != NULL) TTF_CloseFont(it->second.font);
+        for(vector<TTF_Font**>::const_iterator user = it->second.users.begin(); user != it->second.users.end(); ++user)
+            **user = NULL;
+    }
+    loadedFonts.clear();
+}
+
+/* Počet sdílených obrázků */
+unsigned int Skin::duplicateImages(void) const {
+    unsigned int count = 0;
+    for(map<string, SharedImage>::const_iterator it = images.begin(); it != images.end(); ++it)
+        count += it->second.users.size()-1;
+    return count;
+}
+
+/* Počet sdílených fontů */
+unsigned int Skin::duplicateFonts(void) const {
+    unsigned int count = 0;
+    for(map<pair<string, int>, SharedFont>::const_iterator it = loadedFonts.begin(); it != loadedFonts.end(); ++it)
+        count += it->second.users.size()-1;
+    return count;
+}
+
+/* Paměť ušetřená sdílením obrázků */
+unsigned int Skin::sharedImageSize(void) const {
+    unsigned int size = 0;
+    /* Bez pitch, obrázek v atlasu má pitch celého atlasu */
+    for(map<string, SharedImage>::const_iterator it = images.begin(); it != images.end(); ++it) {
+        const SDL_Surface* image = it->second.image;
+        if(image != NULL && it->second.users.size() > 1)
+            size += (it->second.users.size()-1)*(*image).w*(*(*image).format).BytesPerPixel*(*image).h;
+    }
+    return size;
+}
+
+/* Počet obrázků v atlasech */
+unsigned int Skin::atlasImageCount(void) const {
+    unsigned int count = 0;
+    for(map<string, SharedImage>::const_iterator it = images.begin(); it != images.end(); ++it)
+        if(it->second.packed) ++count;
+    return count;
+}
+
+/* Zabalení malých obrázků do atlasů */
+void Skin::pack(void) {
+    /* Malé obrázky seřazené podle výšky */
+    vector<SDL_Surface*> small;
+    map<SDL_Surface*, SharedImage*> owners;
+    for(map<string, SharedImage>::iterator it = images.begin(); it != images.end(); ++it) {
+        SDL_Surface* image = it->second.image;
+        if(image == NULL || (*image).w > ATLAS_MAX_IMAGE || (*image).h > ATLAS_MAX_IMAGE)
+            continue;
+
+        small.push_back(image);
+        owners[image] = &it->second;
+    }
+    stable_sort(small.begin(), small.end(), higherImage);
+
+    /* Žádné malé obrázky, atlasy nejsou potřeba */
+    if(small.empty()) {
+        for(vector<SDL_Surface*>::const_iterator it = atlases.begin(); it != atlases.end(); ++it)
+            SDL_FreeSurface(*it);
+        atlases.clear();
+        return;
+    }
+
+    /* Rozmístění do řádků, nový řádek když se obrázek nevejde do šířky,
+       nový atlas když se řádek nevejde do výšky */
+    vector<AtlasPlacement> placements;
+    vector<int> heights(1, 0);
+    int x = 0, y = 0, rowHeight = 0;
+    for(vector<SDL_Surface*>::const_iterator it = small.begin(); it != small.end(); ++it) {
+        if(x + (**it).w > ATLAS_WIDTH) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        if(y + (**it).h > ATLAS_MAX_HEIGHT) {
+            x = y = rowHeight = 0;
+            heights.push_back(0);
+        }
+
+        AtlasPlacement placement;
+        placement.image = owners[*it];
+        placement.atlas = heights.size()-1;
+        placement.position.x = x;
+        placement.position.y = y;
+        placement.position.w = (**it).w;
+        placement.position.h = (**it).h;
+        placements.push_back(placement);
+
+        x += (**it).w;
+        if((**it).h > rowHeight) rowHeight = (**it).h;
+        heights.back() = y + rowHeight;
+    }
+
+    /* Nové atlasy ve formátu obrázků (všechny jsou ve formátu displeje).
+       Formát se zkopíruje, první obrázek se při kopírování uvolní. */
+    const SDL_PixelFormat format = *(*small.front()).format;
+    vector<SDL_Surface*> packed;
+    for(vector<int>::const_iterator it = heights.begin(); it != heights.end(); ++it) {
+        SDL_Surface* atlas = SDL_CreateRGBSurface(SDL_SWSURFACE, ATLAS_WIDTH, *it,
+            format.BitsPerPixel, format.Rmask, format.Gmask, format.Bmask, format.Amask);
+
+        /* Bez paměti na atlas zůstanou obrázky samostatně */
+        if(atlas == NULL) {
+            for(vector<SDL_Surface*>::const_iterator a = packed.begin(); a != packed.end(); ++a)
+                SDL_FreeSurface(*a);
+            return;
+        }
+
+        packed.push_back(atlas);
+    }
+
+    /* Zkopírování pixelů a nahrazení obrázků surface ukazujícími do atlasu.
+       Kopíruje se po řádcích, blit by pixely s alfou míchal. */
+    for(vector<AtlasPlacement>::const_iterator it = placements.begin(); it != placements.end(); ++it) {
+        SharedImage& image = *(*it).image;
+        SDL_Surface* atlas = packed[(*it).atlas];
+        SDL_Surface* source = image.image;
+        unsigned char* pixels = static_cast<unsigned char*>((*atlas).pixels)
+            + (*it).position.y*(*atlas).pitch + (*it).position.x*format.BytesPerPixel;
+
+        SDL_LockSurface(source);
+        for(int row = 0; row != (*source).h; ++row)
+            memcpy(pixels + row*(*atlas).pitch,
+                   static_cast<unsigned char*>((*source).pixels) + row*(*source).pitch,
+                   (*source).w*format.BytesPerPixel);
+        SDL_UnlockSurface(source);
+
+        SDL_Surface* view = SDL_CreateRGBSurfaceFrom(pixels, (*source).w, (*source).h,
+            format.BitsPerPixel, (*atlas).pitch, format.Rmask, format.Gmask, format.Bmask, format.Amask);
+
+        /* Obrázek z minulého atlasu musí mít vlastní pixely, než se atlas uvolní */
+        if(view == NULL) {
+            if(image.packed) {
+                image.image = SDL_ConvertSurface(source, (*source).format, SDL_SWSURFACE);
+                image.packed = false;
+                SDL_FreeSurface(source);
+                for(vector<SDL_Surface**>::const_iterator user = image.users.begin(); user != image.users.end(); ++user)
+                    **user = image.image;
+            }
+            continue;
+        }
+        SDL_SetAlpha(view, SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+
+        /* Surface ukazující do starého atlasu neuvolňuje pixely */
+        SDL_FreeSurface(source);
+        image.image = view;
+        image.packed = true;
+        for(vector<SDL_Surface**>::const_iterator user = image.users.begin(); user != image.users.end(); ++user)
+            **user = view;
+    }
+
+    /* Staré atlasy už nikdo nepoužívá */
+    for(vector<SDL_Surface*>::const_iterator it = atlases.begin(); it != atlases.end(); ++it)
+        SDL_FreeSurface(*it);
+    atlases.swap(packed);
+}
+
+/* Absolutní cesta */
+string Skin::resolvePath(const string& file) {
+    #ifdef _WIN32
+    char path[_MAX_PATH];
+    if(_fullpath(path, file.c_str(), _MAX_PATH) == NULL) return file;
+    #else
+    char path[PATH_MAX];
+    if(realpath(file.c_str(), path) == NULL) return file;
+    #endif
+
+    return path;
+}
+
+/* Zažádání o dekódování obrázku */
+void Skin::request(const string& file) {
+    Job job;
+    job.file = file;
+    job.image = NULL;
+
+    SDL_LockMutex(mutex);
+    ++pending;
+
+    /* Bez vláken se dekóduje rovnou */
+    if(workers.empty()) {
+        job.image = IMG_Load(file.c_str());
+        done.push_back(job);
+    } else {
+        jobs.push_back(job);
+        SDL_CondSignal(requested);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+/* Dokončení načítání */
+void Skin::finishLoading(void) {
+    SDL_LockMutex(mutex);
+    while(pending != 0) {
+        while(done.empty()) SDL_CondWait(decoded, mutex);
+
+        Job job = done.back();
+        done.pop_back();
+
+        /* Konverze do formátu displeje (jen v hlavním vlákně) bez zámku */
+        SDL_UnlockMutex(mutex);
+        convert(job);
+        SDL_LockMutex(mutex);
+
+        --pending;
+    }
+    warming = false;
+    SDL_UnlockMutex(mutex);
+
+    /* Nové nebo uvolněné obrázky, přebalení atlasů */
+    if(repack) {
+        pack();
+        repack = false;
+    }
+}
+
+/* Konverze dekódovaného obrázku */
+void Skin::convert(const Job& job) {
+    SharedImage& image = images[job.file];
+    if(job.image == NULL)
+        cerr << "Nepodařilo se načíst obrázek '" << image.file << "'." << endl;
+    else {
+        image.image = SDL_DisplayFormatAlpha(job.image);
+        SDL_FreeSurface(job.image);
+        repack = true;
+    }
+
+    /* Nastavení všech ukazatelů, které obrázek sdílejí */
+    for(vector<SDL_Surface**>::const_iterator it = image.users.begin(); it != image.users.end(); ++it)
+        **it = image.image;
+}
+
+/* Vlákno dekódující obrázky */
+int Skin::worker(void* skin) {
+    Skin& s = *static_cast<Skin*>(skin);
+
+    SDL_LockMutex(s.mutex);
+    for(;;) {
+        while(!s.quit && s.jobs.empty()) SDL_CondWait(s.requested, s.mutex);
+        if(s.quit) break;
+
+        Job job = s.jobs.front();
+        s.jobs.pop_front();
+
+        /* Dekódování bez zámku */
+        SDL_UnlockMutex(s.mutex);
+        job.image = IMG_Load(job.file.c_str());
+        SDL_LockMutex(s.mutex);
+
+        s.done.push_back(job);
+        SDL_CondSignal(s.decoded);
+
+        /* Probuzení hlavní smyčky (SDL_PushEvent() je vláknově bezpečná) */
+        if(s.warming) {
+            SDL_Event event;
+            event.type = SDL_USEREVENT;
+            event.user.code = EVENT_IMAGE_DECODED;
+            event.user.data1 = event.user.data2 = NULL;
+            SDL_PushEvent(&event);
+        }
+    }
+    SDL_UnlockMutex(s.mutex);
+
+    return 0;
 }
 
 #ifndef GENERATING_DOXYGEN_OUTPUT
@@ -136,16 +741,9 @@ template<> SDL_Surface** Skin::get(const string& parameter, string section) {
         umístí data a proto by se jednoduchý ukazatel při reloadu surface zničil */
     SDL_Surface** surface = new SDL_Surface*;
 
-    /* Konverze do formátu displeje */
-    SDL_Surface* temp = IMG_Load(file.c_str());
-    if(temp == NULL) {
-        cerr << "Nepodařilo se načíst obrázek '" << file << "'." << endl;
-        *surface = NULL;
-    }
-    else {
-        *surface = SDL_DisplayFormatAlpha(temp);
-        SDL_FreeSurface(temp);
-    }
+    /* Dekódování na pozadí, do Skin::finishLoading je obrázek NULL (v líném
+       režimu do vyžádání průhledný obrázek) */
+    acquireImage(file, surface);
 
     Skin::Property<SDL_Surface**> property;
     property.parameter = parameter;
@@ -166,9 +764,7 @@ template<> TTF_Font** Skin::get(const string& parameter, string section) {
     conf.value(parameter + "Size", fontSize, conf.section(section));
 
     TTF_Font** font = new TTF_Font*;
-    *font = TTF_OpenFont(file.c_str(), fontSize);
-    if(*font == NULL)
-        cerr << "Nepodařilo se načíst font '" << file << "'." << endl;
+    acquireFont(file, fontSize, font);
 
     Skin::Property<TTF_Font**> property;
     property.parameter = parameter;
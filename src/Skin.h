@@ -20,9 +20,14 @@
  * @brief Třída Skin
  */
 
+#include <ctime>
+#include <deque>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
 #include <SDL/SDL_ttf.h>
 
 #include "ConfParser.h"
@@ -37,22 +42,65 @@ namespace Kompas { namespace Sdl {
  * nutnosti restartu aplikace. Založeno na ukazatelích, takže je (téměř) nulová
  * režie při vykreslování. Pro specifikaci skin souborů a podporovaných datových
  * typů viz @ref Skin.
+ *
+ * Obrázky se dekódují paralelně na několika vláknech, konverze do formátu
+ * displeje (kterou SDL umí jen v hlavním vlákně) se provede až ve funkci
+ * Skin::finishLoading. Do té doby ukazují ukazatele na obrázky na NULL.
+ * Fonty se načítají hned v hlavním vlákně (FreeType není vláknově
+ * bezpečný), zatímco se na pozadí dekódují obrázky.
+ *
+ * Stejný soubor s obrázkem (nebo font se stejnou velikostí) požadovaný z více
+ * parametrů se načte jen jednou, všechny ukazatele pak ukazují na stejnou
+ * surface / font. Soubory se porovnávají podle absolutní cesty. Každý
+ * parametr má ale dál svůj vlastní ukazatel, protože v jiném skinu může
+ * mít jiný soubor.
+ *
+ * Malé obrázky (ikony, klávesy, části scrollbaru) se po načtení zabalí do
+ * několika velkých surface (atlasů), ukazatele pak ukazují na surface, která
+ * sdílí pixely s atlasem. Vykreslování se tak nemění, ale pixely malých
+ * obrázků leží v paměti pohromadě. Atlasy se sestavují znovu při každém
+ * dokončení načítání.
+ *
+ * Při znovunačtení skinu se znovu načtou jen obrázky a fonty, jejichž soubor,
+ * velikost nebo čas změny se liší, ostatní zůstanou. Na Linuxu (s inotify)
+ * lze zapnout sledování souborů skinu pomocí Skin::watch, skin se pak po
+ * změně některého souboru sám znovu načte ve funkci Skin::reloadChanged.
+ *
+ * V líném režimu (Skin::lazy) se obrázky při načtení skinu nedekódují,
+ * ukazatele na ně ukazují na průhledný obrázek 1x1. Obrázky potřebné pro
+ * první snímek se vyžádají pomocí Skin::require, ostatní se dekódují na
+ * pozadí po zavolání Skin::warmUp a průběžně převezmou ve Skin::update.
  * @attention Pro správnou funkci této třídy je nutné zavolat TTF_Init()!
  * @todo Přepsat z ukazatelů na reference (asi nepude?)
  * @todo Skiny podle velikosti displeje (větší menu pro větší atd.)
- * @todo Vynechávat načítání stejných věcí vícekrát
  */
 class Skin {
     public:
+        /**
+         * @brief Kód události při dekódování obrázku na pozadí
+         *
+         * Po zavolání Skin::warmUp pošle vlákno po dekódování každého
+         * obrázku SDL_USEREVENT s tímto kódem, aby se probudila hlavní
+         * smyčka čekající na události.
+         */
+        static const int EVENT_IMAGE_DECODED = 0x4b53;
+
+        /**
+         * @brief Líné dekódování obrázků
+         *
+         * Defaultně vypnuto. Platí pro skiny vytvořené po nastavení.
+         */
+        static bool lazy;
 
         /**
          * @brief Konstruktor
          *
          * @param   _screen     Displejová surface
          * @param   file        Soubor se skinem
+         * @param   loaderThreads   Počet vláken dekódujících obrázky
          * @todo Možné problémy při resize (ztráta cíle ukazatele) => dvojitý?
          */
-        inline Skin(SDL_Surface* _screen, const std::string& file): screen(_screen) { load(file); }
+        Skin(SDL_Surface* _screen, const std::string& file, unsigned int loaderThreads = 2);
 
         /** @brief Destruktor */
         ~Skin(void);
@@ -60,10 +108,83 @@ class Skin {
         /**
          * @brief Načtení skinu
          *
+         * Obrázky se dekódují paralelně, funkce skončí až po jejich
+         * načtení (volá Skin::finishLoading).
          * @param   file        Soubor se skinem
          */
         void load(const std::string& file);
 
+        /**
+         * @brief Dokončení načítání obrázků
+         *
+         * Počká na dekódování všech zažádaných obrázků a zkonvertuje je do
+         * formátu displeje. Volat po získání všech obrázků pomocí
+         * Skin::get a před prvním vykreslením.
+         */
+        void finishLoading(void);
+
+        /**
+         * @brief Vyžádání obrázků ze sekce
+         *
+         * V líném režimu zažádá o dekódování všech odložených obrázků z
+         * dané sekce, načtou se při nejbližším Skin::finishLoading nebo
+         * Skin::update. Jinak nedělá nic.
+         * @param   section     Sekce skinu
+         */
+        void require(const std::string& section);
+
+        /**
+         * @brief Dekódování všech odložených obrázků na pozadí
+         *
+         * Volat po zobrazení prvního snímku. Další načítání skinu už
+         * obrázky neodkládá.
+         */
+        void warmUp(void);
+
+        /**
+         * @brief Převzetí obrázků dekódovaných na pozadí
+         *
+         * Neblokuje, převezme jen obrázky, které už jsou dekódované. Pokud
+         * nějaké převezme, nechá překreslit celou obrazovku. Volat
+         * pravidelně v hlavní smyčce.
+         */
+        void update(void);
+
+        /**
+         * @brief Zapnutí / vypnutí sledování změn souborů skinu
+         *
+         * @param   enabled     Zda sledovat
+         * @return  Zda se povedlo (sledování není podporováno bez inotify)
+         */
+        bool watch(bool enabled);
+
+        /** @brief Zda se sledují změny souborů skinu */
+        inline bool isWatching(void) const { return watcher != -1; }
+
+        /**
+         * @brief Znovunačtení skinu, pokud se změnil některý jeho soubor
+         *
+         * Neblokuje. Volat pravidelně v hlavní smyčce, pokud jsou změny
+         * sledovány.
+         * @return  Zda byl skin znovu načten
+         */
+        bool reloadChanged(void);
+
+        /** @brief Počet obrázků, které se díky sdílení nenačítaly znovu */
+        unsigned int duplicateImages(void) const;
+
+        /** @brief Počet fontů, které se díky sdílení nenačítaly znovu */
+        unsigned int duplicateFonts(void) const;
+
+        /** @brief Paměť ušetřená sdílením obrázků (v bajtech) */
+        unsigned int sharedImageSize(void) const;
+
+        /** @brief Počet atlasů */
+        inline unsigned int atlasCount(void) const { return atlases.size(); }
+
+        /** @brief Počet obrázků zabalených v atlasech */
+        unsigned int atlasImageCount(void) const;
+
         /**
          * @brief Získání ukazatele na vlastnost
          *
@@ -83,9 +204,162 @@ class Skin {
             T property;             /**< @brief Vlastnost */
         };
 
+        /** @brief Obrázek k dekódování */
+        struct Job {
+            std::string file;       /**< @brief Soubor s obrázkem (absolutní cesta) */
+            SDL_Surface* image;     /**< @brief Dekódovaný obrázek (NULL při chybě) */
+        };
+
+        /** @brief Sdílený obrázek */
+        struct SharedImage {
+            std::string file;       /**< @brief Soubor, jak byl uveden v conf souboru */
+            time_t modified;        /**< @brief Čas změny souboru při načtení */
+            SDL_Surface* image;     /**< @brief Obrázek (NULL při chybě nebo při dekódování) */
+            bool deferred;          /**< @brief Zda je dekódování odloženo */
+            bool packed;            /**< @brief Zda obrázek sdílí pixely s atlasem */
+            std::vector<SDL_Surface**> users; /**< @brief Ukazatele, které na obrázek ukazují */
+        };
+
+        /** @brief Umístění obrázku v atlasu */
+        struct AtlasPlacement {
+            SharedImage* image;     /**< @brief Obrázek */
+            unsigned int atlas;     /**< @brief Index atlasu */
+            SDL_Rect position;      /**< @brief Pozice v atlasu */
+        };
+
+        /** @brief Šířka atlasu */
+        static const int ATLAS_WIDTH = 256;
+
+        /** @brief Maximální výška atlasu */
+        static const int ATLAS_MAX_HEIGHT = 1024;
+
+        /** @brief Maximální rozměr obrázku, který se balí do atlasu */
+        static const int ATLAS_MAX_IMAGE = 96;
+
+        /** @brief Sdílený font */
+        struct SharedFont {
+            TTF_Font* font;         /**< @brief Font (NULL při chybě) */
+            time_t modified;        /**< @brief Čas změny souboru při načtení */
+            std::vector<TTF_Font**> users; /**< @brief Ukazatele, které na font ukazují */
+        };
+
         SDL_Surface* screen;    /**< @brief Displejová surface */
+        std::string skinFile;   /**< @brief Soubor se skinem */
         ConfParser conf;        /**< @brief Konfigurák skinu */
 
+        std::vector<SDL_Thread*> workers;   /**< @brief Vlákna dekódující obrázky */
+        SDL_mutex* mutex;           /**< @brief Zámek pro data níže */
+        SDL_cond* requested;        /**< @brief Signál pro vlákna, že je co dekódovat */
+        SDL_cond* decoded;          /**< @brief Signál pro hlavní vlákno, že je co konvertovat */
+        bool quit;                  /**< @brief Ukončení vláken */
+        std::deque<Job> jobs;       /**< @brief Obrázky čekající na dekódování */
+        std::vector<Job> done;      /**< @brief Dekódované obrázky čekající na konverzi */
+        unsigned int pending;       /**< @brief Počet obrázků zažádaných a ještě nezkonvertovaných */
+        bool warming;               /**< @brief Zda se obrázky dekódují na pozadí (posílání událostí) */
+
+        bool deferring;             /**< @brief Zda se dekódování obrázků odkládá */
+        SDL_Surface* placeholder;   /**< @brief Průhledný obrázek místo odložených obrázků */
+
+        /** @brief Načtené obrázky podle absolutní cesty */
+        std::map<std::string, SharedImage> images;
+
+        /** @brief Načtené fonty podle absolutní cesty a velikosti */
+        std::map<std::pair<std::string, int>, SharedFont> loadedFonts;
+
+        /** @brief Atlasy s malými obrázky */
+        std::vector<SDL_Surface*> atlases;
+
+        /** @brief Zda je potřeba znovu zabalit atlasy */
+        bool repack;
+
+        int watcher;            /**< @brief Deskriptor inotify (-1, pokud se nesleduje) */
+        std::map<int, std::string> watched; /**< @brief Sledované adresáře podle deskriptoru */
+        std::set<std::string> watchedFiles; /**< @brief Sledované soubory (absolutní cesty) */
+
+        /**
+         * @brief Soubory změněné podle inotify (absolutní cesty)
+         *
+         * Při znovunačtení se uvolní vždy, i když se jejich čas změny
+         * nezměnil (má rozlišení sekundy, druhé uložení ve stejné sekundě
+         * by jinak prošlo).
+         */
+        std::set<std::string> changedFiles;
+
+        /** @brief Přidání souborů skinu ke sledování */
+        void addWatches(void);
+
+        /**
+         * @brief Uvolnění změněných a nepoužívaných obrázků a fontů
+         *
+         * Ukazatele na uvolněné budou NULL, u ponechaných se vyprázdní
+         * seznam ukazatelů, aby je šlo znovu přiřadit. Soubory v
+         * Skin::changedFiles se uvolní vždy.
+         * @param   usedImages  Obrázky, které nový skin používá
+         * @param   usedFonts   Fonty (a velikosti), které nový skin používá
+         */
+        void releaseUnused(const std::set<std::string>& usedImages, const std::set<std::pair<std::string, int> >& usedFonts);
+
+        /** @brief Čas poslední změny souboru (0, pokud neexistuje) */
+        static time_t modificationTime(const std::string& file);
+
+        /**
+         * @brief Zabalení malých obrázků do atlasů
+         *
+         * Rozmístí všechny malé obrázky do řádků v atlasech (seřazené podle
+         * výšky), zkopíruje do nich pixely a nahradí obrázky surface
+         * ukazujícími do atlasu. Staré atlasy uvolní.
+         */
+        void pack(void);
+
+        /**
+         * @brief Získání obrázku
+         *
+         * Pokud už byl stejný soubor načten nebo zažádán, jen nastaví
+         * ukazatel na něj, jinak zažádá o jeho dekódování.
+         * @param   file        Soubor s obrázkem
+         * @param   surface     Kam obrázek uložit
+         */
+        void acquireImage(const std::string& file, SDL_Surface** surface);
+
+        /**
+         * @brief Získání fontu
+         *
+         * Pokud už byl stejný font ve stejné velikosti načten, jen nastaví
+         * ukazatel na něj.
+         * @param   file        Soubor s fontem
+         * @param   size        Velikost fontu
+         * @param   font        Kam font uložit
+         */
+        void acquireFont(const std::string& file, int size, TTF_Font** font);
+
+        /** @brief Uvolnění všech obrázků a fontů, ukazatele budou NULL */
+        void releaseAssets(void);
+
+        /**
+         * @brief Zažádání o dekódování obrázku
+         *
+         * @param   file        Soubor s obrázkem (absolutní cesta)
+         */
+        void request(const std::string& file);
+
+        /**
+         * @brief Konverze dekódovaného obrázku
+         *
+         * Zkonvertuje obrázek do formátu displeje a nastaví na něj všechny
+         * ukazatele. Volat bez zámku.
+         */
+        void convert(const Job& job);
+
+        /**
+         * @brief Absolutní cesta k souboru
+         *
+         * Pokud soubor neexistuje, vrací cestu beze změny.
+         */
+        static std::string resolvePath(const std::string& file);
+
+        /** @brief Vlákno dekódující obrázky */
+        static int worker(void* skin);
+
         std::vector<Property<SDL_Surface**> > surfaces; /**< @brief Vektor se surfacy */
         std::vector<Property<TTF_Font**> > fonts;       /**< @brief Vektor s fonty */
         std::vector<Property<SDL_Rect*> > positions;    /**< @brief Vektor s pozicemi */
@@ -17,6 +17,7 @@
 
 #include <iostream>
 
+#include "Compositor.h"
 #include "Effects.h"
 
 using namespace std;
@@ -28,22 +29,23 @@ void Splash::view(void){
     /* Vyplnění pozadí černou barvou */
     SDL_FillRect(screen, NULL, SDL_MapRGB((*screen).format, 0, 0, 0));
 
-    /* Plocha pro vykreslování splashe */
-    SDL_Rect area = Effects::align(screen, *align, *position);
+    /* Předpočítané rozvržení */
+    updateLayout();
 
-    /* Zobrazení obrázku */
-    SDL_BlitSurface(*image, NULL, screen, &area);
+    /* Zobrazení obrázku (SDL_BlitSurface mění cílový obdélník při ořezu) */
+    SDL_Rect imageArea = area;
+    SDL_BlitSurface(*image, NULL, screen, &imageArea);
 
     /* Zobrazení textů */
     for(vector<Text>::const_iterator it = texts.begin(); it != texts.end(); ++it) {
         /* Oblast textu */
-        SDL_Rect textArea = Effects::align(area, ALIGN_DEFAULT, *(*it).position);
-        SDL_Surface* text = (*Effects::textRenderFunction())(*(*it).font, (*(*it).text).c_str(), *(*it).color);
+        const SDL_Rect& textArea = textAreas[it-texts.begin()];
+        int textW, textH;
+        Effects::textSize(*(*it).font, *(*it).text, textW, textH);
 
-        SDL_Rect dst = Effects::align(textArea, *(*it).align, (*text).w, (*text).h);
+        SDL_Rect dst = Effects::align(textArea, *(*it).align, textW, textH);
         SDL_Rect textCrop = {0, 0, dst.w, dst.h};
-        SDL_BlitSurface(text, &textCrop, screen, &dst);
-        SDL_FreeSurface(text);
+        Effects::blitText(*(*it).font, *(*it).text, *(*it).color, &textCrop, screen, &dst);
     }
 }
 
@@ -56,6 +58,25 @@ void Splash::addText (TTF_Font** font, SDL_Color* color, SDL_Rect* _position, Al
     _text.align = _align;
     _text.text = text;
     texts.push_back(_text);
+    layoutGeneration = 0;
+}
+
+/* Oblast splashe */
+SDL_Rect Splash::bounds(void) {
+    SDL_Rect whole = {0, 0, (*screen).w, (*screen).h};
+    return whole;
+}
+
+/* Aktualizace rozvržení */
+void Splash::updateLayout(void) {
+    if(layoutGeneration == Compositor::layoutGeneration()) return;
+    layoutGeneration = Compositor::layoutGeneration();
+
+    area = Effects::align(screen, *align, *position);
+
+    textAreas.clear();
+    for(vector<Text>::const_iterator it = texts.begin(); it != texts.end(); ++it)
+        textAreas.push_back(Effects::align(area, ALIGN_DEFAULT, *(*it).position));
 }
 
 }}
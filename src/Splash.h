@@ -25,6 +25,7 @@
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 
+#include "Scene.h"
 #include "utility.h"
 
 namespace Kompas { namespace Sdl {
@@ -34,7 +35,7 @@ namespace Kompas { namespace Sdl {
  *
  * Zobrazí obrázek a texty na pozadí. Plná podpora Skin a Localize.
  */
-class Splash {
+class Splash: public SceneNode {
     public:
         /**
          * @brief Konstruktor
@@ -46,7 +47,8 @@ class Splash {
          * @todo Možné problémy při resize screen (ztráta cíle ukazatele) => dvojitý?
          */
         inline Splash(SDL_Surface* _screen, SDL_Surface** _image, SDL_Rect* _position, Align* _align):
-            screen(_screen), image(_image), position(_position), align(_align) {}
+            screen(_screen), image(_image), position(_position), align(_align),
+            layoutGeneration(0) {}
 
         /**
          * @brief Vložení textu
@@ -61,6 +63,12 @@ class Splash {
 
         /** @brief Zobrazení splashe */
         void view(void);
+
+        /** @brief Oblast splashe (celá obrazovka, pozadí je vyplněné černou) */
+        SDL_Rect bounds(void);
+
+        /** @brief Splash je neprůhledný */
+        inline bool isOpaque(void) const { return true; }
     private:
         /** @brief Struktura pro text */
         struct Text {
@@ -76,6 +84,18 @@ class Splash {
         SDL_Rect* position;         /**< @brief Pozice splashe */
         Align* align;     /**< @brief Zarování splashe vůči displeji */
         std::vector<Text> texts;    /**< @brief Vektor s texty */
+
+        unsigned int layoutGeneration;  /**< @brief Generace rozvržení (0, pokud je potřeba přepočítat) */
+        SDL_Rect area;              /**< @brief Oblast splashe */
+        std::vector<SDL_Rect> textAreas;    /**< @brief Oblasti textů */
+
+        /**
+         * @brief Aktualizace rozvržení
+         *
+         * Přepočítá oblasti splashe a textů, pokud se změnila generace
+         * rozvržení (viz Compositor::layoutGeneration) nebo texty.
+         */
+        void updateLayout(void);
 };
 
 }}
@@ -0,0 +1,82 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "TileCache.h"
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+TileCache::~TileCache(void) {
+    clear();
+}
+
+void TileCache::clear(void) {
+    for(list<Tile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it)
+        SDL_FreeSurface(it->image);
+
+    tiles.clear();
+    index.clear();
+    _size = 0;
+}
+
+SDL_Surface* TileCache::take(const TileCoordinates& coordinates) {
+    map<TileCoordinates, list<Tile>::iterator>::iterator found = index.find(coordinates);
+    if(found == index.end()) {
+        ++_misses;
+        return NULL;
+    }
+
+    ++_hits;
+    SDL_Surface* image = found->second->image;
+    _size -= imageSize(image);
+    tiles.erase(found->second);
+    index.erase(found);
+    return image;
+}
+
+void TileCache::put(const TileCoordinates& coordinates, SDL_Surface* image) {
+    /* Replace the tile, if it is already there */
+    map<TileCoordinates, list<Tile>::iterator>::iterator found = index.find(coordinates);
+    if(found != index.end()) {
+        _size -= imageSize(found->second->image);
+        SDL_FreeSurface(found->second->image);
+        tiles.erase(found->second);
+        index.erase(found);
+    }
+
+    Tile tile;
+    tile.coordinates = coordinates;
+    tile.image = image;
+    tiles.push_front(tile);
+    index[coordinates] = tiles.begin();
+    _size += imageSize(image);
+
+    /* Evict least recently used tiles until the cache fits into the budget */
+    unsigned int limit = *budget > 0 ? *budget*1024 : 0;
+    while(_size > limit && !tiles.empty()) {
+        _size -= imageSize(tiles.back().image);
+        SDL_FreeSurface(tiles.back().image);
+        index.erase(tiles.back().coordinates);
+        tiles.pop_back();
+        ++_evictions;
+    }
+}
+
+unsigned int TileCache::imageSize(const SDL_Surface* image) {
+    return sizeof(SDL_Surface) + (*image).pitch*(*image).h;
+}
+
+}}
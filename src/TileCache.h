@@ -0,0 +1,124 @@
+#ifndef Kompas_Sdl_TileCache_h
+#define Kompas_Sdl_TileCache_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Sdl::TileCache
+ */
+
+#include <list>
+#include <map>
+#include <SDL/SDL.h>
+
+#include "utility.h"
+
+namespace Kompas { namespace Sdl {
+
+/**
+ * @brief LRU cache of decoded map tiles
+ *
+ * Keeps decoded tiles which scrolled out of the map, so panning back doesn't
+ * decode them again. The cache owns all surfaces put into it, surfaces taken
+ * out with take() are owned by the caller. When the total size of cached
+ * surfaces exceeds the budget, least recently used tiles are freed.
+ */
+class TileCache {
+    public:
+        /**
+         * @brief Constructor
+         * @param _budget       Pointer to cache budget in kilobytes. Pointer
+         *  is used so the budget can be taken directly from Skin and changed
+         *  on-the-fly.
+         */
+        inline TileCache(const int* _budget): budget(_budget), _size(0), _hits(0), _misses(0), _evictions(0) {}
+
+        /** @brief Destructor, frees all cached tiles */
+        ~TileCache(void);
+
+        /**
+         * @brief Take tile out of the cache
+         * @param coordinates   Tile coordinates
+         * @return Tile image, which is removed from the cache and owned by
+         *  the caller, or NULL if the tile is not in the cache.
+         */
+        SDL_Surface* take(const TileCoordinates& coordinates);
+
+        /**
+         * @brief Whether the tile is in the cache
+         * @param coordinates   Tile coordinates
+         *
+         * Doesn't affect hit and miss counters nor the order of tiles.
+         */
+        inline bool contains(const TileCoordinates& coordinates) const {
+            return index.find(coordinates) != index.end();
+        }
+
+        /**
+         * @brief Put tile into the cache
+         * @param coordinates   Tile coordinates
+         * @param image         Tile image. The cache takes its ownership.
+         *
+         * Makes the tile most recently used and evicts least recently used
+         * tiles until the cache fits into the budget.
+         */
+        void put(const TileCoordinates& coordinates, SDL_Surface* image);
+
+        /**
+         * @brief Free all cached tiles
+         *
+         * Used when tiles from different source are going to be displayed.
+         * Counters are not reset.
+         */
+        void clear(void);
+
+        /** @brief Size of all cached images in bytes */
+        inline unsigned int size(void) const { return _size; }
+
+        /** @brief Count of cached tiles */
+        inline unsigned int count(void) const { return tiles.size(); }
+
+        /** @brief Count of cache hits */
+        inline unsigned int hits(void) const { return _hits; }
+
+        /** @brief Count of cache misses */
+        inline unsigned int misses(void) const { return _misses; }
+
+        /** @brief Count of evicted tiles */
+        inline unsigned int evictions(void) const { return _evictions; }
+
+    private:
+        struct Tile {
+            TileCoordinates coordinates;
+            SDL_Surface* image;
+        };
+
+        const int* budget;
+        unsigned int _size, _hits, _misses, _evictions;
+
+        /* Most recently used tiles are at the front */
+        std::list<Tile> tiles;
+        std::map<TileCoordinates, std::list<Tile>::iterator> index;
+
+        static unsigned int imageSize(const SDL_Surface* image);
+
+        /* Copying is not allowed (cache owns the surfaces) */
+        TileCache(const TileCache&);
+        TileCache& operator=(const TileCache&);
+};
+
+}}
+
+#endif
@@ -0,0 +1,218 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "TileLoader.h"
+
+#include <algorithm>    /* find() */
+#include <iostream>
+#include <sstream>
+#include <SDL/SDL_image.h>
+
+#include "TilePackage.h"
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+TileLoader::TileLoader(const SDL_PixelFormat& _format, const string& _directory, unsigned int workerCount): format(_format), directory(_directory), package(NULL), quit(false) {
+    start(workerCount);
+}
+
+TileLoader::TileLoader(const SDL_PixelFormat& _format, const TilePackage* _package, unsigned int workerCount): format(_format), package(_package), quit(false) {
+    start(workerCount);
+}
+
+void TileLoader::start(unsigned int workerCount) {
+    /* Display formats of 15/16/24/32bit modes don't have any palette, but
+       make sure we don't hold pointer to palette of a surface which can
+       disappear on resize */
+    format.palette = NULL;
+
+    mutex = SDL_CreateMutex();
+    condition = SDL_CreateCond();
+
+    for(unsigned int i = 0; i != workerCount; ++i) {
+        SDL_Thread* thread = SDL_CreateThread(worker, this);
+        if(thread == NULL) {
+            cerr << "Cannot create tile loader thread: " << SDL_GetError() << endl;
+            continue;
+        }
+        workers.push_back(thread);
+    }
+}
+
+TileLoader::~TileLoader(void) {
+    /* Wake up all workers and wait for them */
+    SDL_LockMutex(mutex);
+    quit = true;
+    SDL_CondBroadcast(condition);
+    SDL_UnlockMutex(mutex);
+
+    for(vector<SDL_Thread*>::const_iterator it = workers.begin(); it != workers.end(); ++it)
+        SDL_WaitThread(*it, NULL);
+
+    /* Free tiles which were never picked up */
+    for(vector<Tile>::const_iterator it = done.begin(); it != done.end(); ++it)
+        if(it->image) SDL_FreeSurface(it->image);
+
+    SDL_DestroyCond(condition);
+    SDL_DestroyMutex(mutex);
+}
+
+void TileLoader::request(const TileCoordinates& coordinates, Priority priority) {
+    SDL_LockMutex(mutex);
+
+    /* Already requested with normal priority or being decoded */
+    if(find(requests.begin(), requests.end(), coordinates) != requests.end() ||
+       find(inProgress.begin(), inProgress.end(), coordinates) != inProgress.end()) {
+        SDL_UnlockMutex(mutex);
+        return;
+    }
+
+    deque<TileCoordinates>::iterator low = find(lowPriorityRequests.begin(), lowPriorityRequests.end(), coordinates);
+    if(low != lowPriorityRequests.end()) {
+        /* Already requested with low priority, raise it if needed */
+        if(priority == NORMAL) {
+            lowPriorityRequests.erase(low);
+            requests.push_back(coordinates);
+        }
+    } else {
+        if(priority == NORMAL) requests.push_back(coordinates);
+        else lowPriorityRequests.push_back(coordinates);
+        SDL_CondSignal(condition);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+void TileLoader::cancel(const TileCoordinates& coordinates) {
+    SDL_LockMutex(mutex);
+
+    /* Not yet started, remove from queue */
+    deque<TileCoordinates>::iterator request = find(requests.begin(), requests.end(), coordinates);
+    deque<TileCoordinates>::iterator low;
+    if(request != requests.end()) requests.erase(request);
+    else if((low = find(lowPriorityRequests.begin(), lowPriorityRequests.end(), coordinates)) != lowPriorityRequests.end())
+        lowPriorityRequests.erase(low);
+
+    /* Being decoded, the worker will throw the result away */
+    else {
+        vector<TileCoordinates>::iterator running = find(inProgress.begin(), inProgress.end(), coordinates);
+        if(running != inProgress.end()) inProgress.erase(running);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+bool TileLoader::pending(void) const {
+    SDL_LockMutex(mutex);
+    bool found = !requests.empty() || !lowPriorityRequests.empty() ||
+                 !inProgress.empty() || !done.empty();
+    SDL_UnlockMutex(mutex);
+    return found;
+}
+
+bool TileLoader::finished(Tile& tile) {
+    SDL_LockMutex(mutex);
+
+    bool found = !done.empty();
+    if(found) {
+        tile = done.back();
+        done.pop_back();
+    }
+
+    SDL_UnlockMutex(mutex);
+    return found;
+}
+
+int TileLoader::worker(void* loader) {
+    TileLoader& l = *static_cast<TileLoader*>(loader);
+
+    SDL_LockMutex(l.mutex);
+    for(;;) {
+        while(!l.quit && l.requests.empty() && l.lowPriorityRequests.empty())
+            SDL_CondWait(l.condition, l.mutex);
+
+        if(l.quit) break;
+
+        /* Low priority requests only if there is nothing more important */
+        deque<TileCoordinates>& queue = l.requests.empty() ? l.lowPriorityRequests : l.requests;
+        Tile tile;
+        tile.coordinates = queue.front();
+        queue.pop_front();
+        l.inProgress.push_back(tile.coordinates);
+
+        /* Decode without holding the lock */
+        SDL_UnlockMutex(l.mutex);
+        tile.image = l.decode(tile.coordinates);
+        SDL_LockMutex(l.mutex);
+
+        /* If the request was canceled in the meantime, throw it away */
+        vector<TileCoordinates>::iterator running = find(l.inProgress.begin(), l.inProgress.end(), tile.coordinates);
+        if(running != l.inProgress.end()) {
+            l.inProgress.erase(running);
+            l.done.push_back(tile);
+
+            /* Wake up the main loop (SDL_PushEvent() is thread-safe) */
+            SDL_Event event;
+            event.type = SDL_USEREVENT;
+            event.user.code = EVENT_TILE_DECODED;
+            event.user.data1 = event.user.data2 = NULL;
+            SDL_PushEvent(&event);
+        } else if(tile.image) SDL_FreeSurface(tile.image);
+    }
+    SDL_UnlockMutex(l.mutex);
+
+    return 0;
+}
+
+SDL_Surface* TileLoader::decode(const TileCoordinates& coordinates) {
+    SDL_Surface* temp;
+
+    /* Raw tiles from the package need no decoding */
+    if(package && (*package).format() != TilePackage::IMAGE) {
+        temp = (*package).rawTile(coordinates);
+        if(!temp) return NULL;
+
+        /* Tile is already in display format, no conversion needed. Surface
+           of uncompressed tile points directly to the mapped memory. */
+        if(format.BitsPerPixel == 16 && format.Rmask == (*(*temp).format).Rmask &&
+           format.Gmask == (*(*temp).format).Gmask && format.Bmask == (*(*temp).format).Bmask)
+            return temp;
+    }
+
+    /* Decoding straight from the mapped package */
+    else if(package) {
+        SDL_RWops* data = (*package).open(coordinates);
+        if(!data) return NULL;
+        temp = IMG_Load_RW(data, 1);
+
+    } else {
+        ostringstream file;
+        file << directory << '/' << coordinates.zoom << '/' << coordinates.x << '/'
+             << coordinates.y << ".png";
+        temp = IMG_Load(file.str().c_str());
+    }
+
+    if(!temp) return NULL;
+
+    /* Conversion to display format. SDL_DisplayFormat() cannot be used
+       outside the main thread, so convert to a copy of its pixel format. */
+    SDL_Surface* image = SDL_ConvertSurface(temp, &format, SDL_SWSURFACE);
+    SDL_FreeSurface(temp);
+    return image;
+}
+
+}}
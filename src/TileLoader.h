@@ -0,0 +1,165 @@
+#ifndef Kompas_Sdl_TileLoader_h
+#define Kompas_Sdl_TileLoader_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Sdl::TileLoader
+ */
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+#include "utility.h"
+
+namespace Kompas { namespace Sdl {
+
+class TilePackage;
+
+/**
+ * @brief Asynchronous tile loader
+ *
+ * Decodes map tiles on a pool of worker threads, so the main loop is never
+ * blocked by image decoding. Tiles are requested with request(), decoded
+ * tiles (already converted to display format) are picked up on the main
+ * thread with finished(). Requests for tiles which are not needed anymore
+ * can be canceled with cancel(), their decoded surfaces are then freed by
+ * the worker and never returned. Every decoded tile also pushes
+ * SDL_USEREVENT with code EVENT_TILE_DECODED, so an idle main loop blocked
+ * on event waiting is woken up. Low priority requests (e.g. prefetching) are
+ * processed only if there are no normal priority requests waiting.
+ *
+ * Tiles are loaded either from @c directory/zoom/x/y.png or from a
+ * TilePackage. Raw tiles from the package which are already in the display
+ * pixel format are returned without any conversion.
+ * @attention SDL must be initialized with video mode set before creating
+ *  the loader.
+ */
+class TileLoader {
+    public:
+        /**
+         * @brief Code of SDL_USEREVENT pushed when a tile is decoded
+         *
+         * Wakes up the main loop if it is waiting for events.
+         */
+        static const int EVENT_TILE_DECODED = 0x4b54;
+
+        /** @brief Request priority */
+        enum Priority {
+            NORMAL,         /**< @brief Tile is needed right now */
+            LOW             /**< @brief Tile will be probably needed later */
+        };
+
+        /** @brief Decoded tile */
+        struct Tile {
+            TileCoordinates coordinates;    /**< @brief Tile coordinates */
+
+            /** @brief Tile image (NULL if the tile cannot be loaded) */
+            SDL_Surface* image;
+        };
+
+        /**
+         * @brief Constructor
+         * @param _format       Pixel format to which decoded tiles are
+         *  converted (usually display pixel format)
+         * @param _directory    Directory with tiles
+         * @param workerCount   Count of worker threads
+         */
+        TileLoader(const SDL_PixelFormat& _format, const std::string& _directory, unsigned int workerCount = 2);
+
+        /**
+         * @brief Constructor
+         * @param _format       Pixel format to which decoded tiles are
+         *  converted (usually display pixel format)
+         * @param _package      Tile package. The package must exist for
+         *  the whole loader lifetime.
+         * @param workerCount   Count of worker threads
+         */
+        TileLoader(const SDL_PixelFormat& _format, const TilePackage* _package, unsigned int workerCount = 2);
+
+        /**
+         * @brief Destructor
+         *
+         * Waits for all workers to finish and frees all decoded tiles which
+         * were not picked up.
+         */
+        ~TileLoader(void);
+
+        /**
+         * @brief Request a tile
+         * @param coordinates   Tile coordinates
+         * @param priority      Request priority
+         *
+         * If the tile is already requested or being decoded, nothing is done,
+         * except for the case when low priority request is raised to normal
+         * priority.
+         */
+        void request(const TileCoordinates& coordinates, Priority priority = NORMAL);
+
+        /**
+         * @brief Cancel tile request
+         * @param coordinates   Tile coordinates
+         *
+         * If the tile is waiting in the queue, it is removed from it. If it
+         * is being decoded right now, the result is thrown away.
+         */
+        void cancel(const TileCoordinates& coordinates);
+
+        /**
+         * @brief Pick up decoded tile
+         * @param tile          Where to save the tile. Ownership of the
+         *  image is transferred to the caller.
+         * @return Whether any decoded tile was available
+         */
+        bool finished(Tile& tile);
+
+        /**
+         * @brief Whether any request is waiting, being decoded or not picked up
+         *
+         * If not, no EVENT_TILE_DECODED event will come.
+         */
+        bool pending(void) const;
+
+    private:
+        SDL_PixelFormat format;
+        std::string directory;
+        const TilePackage* package;
+        std::vector<SDL_Thread*> workers;
+
+        /* Everything below is guarded by the mutex */
+        SDL_mutex* mutex;
+        SDL_cond* condition;
+        bool quit;
+        std::deque<TileCoordinates> requests, lowPriorityRequests;
+        std::vector<TileCoordinates> inProgress;
+        std::vector<Tile> done;
+
+        static int worker(void* loader);
+
+        void start(unsigned int workerCount);
+
+        SDL_Surface* decode(const TileCoordinates& coordinates);
+
+        /* Copying is not allowed (threads are bound to the instance) */
+        TileLoader(const TileLoader&);
+        TileLoader& operator=(const TileLoader&);
+};
+
+}}
+
+#endif
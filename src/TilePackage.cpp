@@ -0,0 +1,163 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+#include "TilePackage.h"
+
+#include <cstring>      /* memcmp() */
+#include <iostream>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace Kompas { namespace Sdl {
+
+TilePackage::TilePackage(const string& file): data(NULL), size(0), _format(IMAGE), _count(0) {
+    mapped = new MappedFile(file);
+    if(!(*mapped).isValid()) {
+        cerr << "Cannot open tile package " << file << endl;
+        unmap();
+        return;
+    }
+    data = (*mapped).data();
+    size = (*mapped).size();
+
+    /* Header and index validation */
+    if(size < 16 || memcmp(data, "KTPK", 4) != 0 || read(data+4) != 1) {
+        cerr << "Invalid tile package " << file << endl;
+        unmap();
+        return;
+    }
+    _format = static_cast<Format>(read(data+8));
+    _count = read(data+12);
+    if((size-16)/entrySize < _count) {
+        cerr << "Truncated index in tile package " << file << endl;
+        unmap();
+        return;
+    }
+}
+
+TilePackage::~TilePackage(void) {
+    unmap();
+}
+
+bool TilePackage::find(const TileCoordinates& coordinates, const unsigned char*& tileData, unsigned int& tileSize) const {
+    const unsigned char* index = data+16;
+
+    /* Binary search in the sorted index */
+    unsigned int first = 0, last = _count;
+    while(first < last) {
+        unsigned int middle = first+(last-first)/2;
+        const unsigned char* entry = index+middle*entrySize;
+        TileCoordinates current = {read(entry), read(entry+4), read(entry+8)};
+
+        if(current < coordinates) first = middle+1;
+        else if(coordinates < current) last = middle;
+        else {
+            unsigned int offset = read(entry+12), length = read(entry+16);
+
+            /* Don't read past the end of corrupted file */
+            if(offset > size || length > size-offset) return false;
+
+            tileData = data+offset;
+            tileSize = length;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SDL_RWops* TilePackage::open(const TileCoordinates& coordinates) const {
+    const unsigned char* tileData;
+    unsigned int tileSize;
+    if(!find(coordinates, tileData, tileSize)) return NULL;
+
+    return SDL_RWFromConstMem(tileData, tileSize);
+}
+
+SDL_Surface* TilePackage::rawTile(const TileCoordinates& coordinates) const {
+    const unsigned char* tileData;
+    unsigned int tileSize;
+    if((_format != RGB565 && _format != RGB565_RLE) ||
+       !find(coordinates, tileData, tileSize) || tileSize < 8)
+        return NULL;
+
+    unsigned int w = read(tileData), h = read(tileData+4);
+    const unsigned char* pixels = tileData+8;
+    unsigned int pixelsSize = tileSize-8;
+
+    /* Corrupted size, don't let a few bytes of RLE allocate gigabytes */
+    if(w == 0 || h == 0 || w > maxTileSize || h > maxTileSize) return NULL;
+
+    if(_format == RGB565) {
+        if(pixelsSize/2/w < h) return NULL;
+
+        /* Zero copy, if the pixels are in native byte order and aligned */
+        #if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        if(reinterpret_cast<size_t>(pixels)%2 == 0)
+            return SDL_CreateRGBSurfaceFrom(const_cast<unsigned char*>(pixels), w, h, 16, w*2, 0xF800, 0x07E0, 0x001F, 0);
+        #endif
+    }
+
+    SDL_Surface* image = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 16, 0xF800, 0x07E0, 0x001F, 0);
+    if(!image) return NULL;
+
+    /* Copy with byte order conversion */
+    if(_format == RGB565) {
+        for(unsigned int y = 0; y != h; ++y) {
+            Uint16* line = reinterpret_cast<Uint16*>(static_cast<Uint8*>((*image).pixels)+y*(*image).pitch);
+            for(unsigned int x = 0; x != w; ++x)
+                line[x] = read16(pixels+(y*w+x)*2);
+        }
+
+        return image;
+    }
+
+    /* RLE decompression */
+    unsigned int x = 0, y = 0;
+    for(unsigned int i = 0; i+4 <= pixelsSize && y != h; i += 4) {
+        unsigned int run = read16(pixels+i);
+        Uint16 pixel = read16(pixels+i+2);
+
+        for(; run != 0 && y != h; --run) {
+            reinterpret_cast<Uint16*>(static_cast<Uint8*>((*image).pixels)+y*(*image).pitch)[x] = pixel;
+            if(++x == w) { x = 0; ++y; }
+        }
+    }
+
+    /* Not enough data */
+    if(y != h) {
+        SDL_FreeSurface(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+void TilePackage::unmap(void) {
+    delete mapped;
+    mapped = NULL;
+
+    data = NULL;
+    size = 0;
+    _count = 0;
+}
+
+unsigned int TilePackage::read(const unsigned char* position) {
+    return position[0] | position[1] << 8 | position[2] << 16 | (unsigned int) position[3] << 24;
+}
+
+}}
@@ -0,0 +1,154 @@
+#ifndef Kompas_Sdl_TilePackage_h
+#define Kompas_Sdl_TilePackage_h
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Class Kompas::Sdl::TilePackage
+ */
+
+#include <string>
+#include <SDL/SDL.h>
+
+#include "utility.h"
+
+namespace Kompas { namespace Sdl {
+
+class MappedFile;
+
+/**
+ * @brief Map tile package
+ *
+ * Single file containing all tiles of a map. The file is memory-mapped, so
+ * opening a package doesn't read anything up front and tiles are decoded
+ * directly from the mapped memory. All functions are const and the mapping
+ * is read-only, so one package can be used from more threads at once.
+ *
+ * <strong>File format:</strong> All numbers are 32bit unsigned little
+ * endian.
+ *  - Header: magic @c "KTPK", version (currently 1), tile format (see
+ *    TilePackage::Format), tile count.
+ *  - Index: for every tile zoom, x, y, offset of tile data from the beginning
+ *    of the file and tile data length. The index is sorted by zoom, then x,
+ *    then y, so a tile is found with binary search.
+ *  - Tile data, concatenated. Raw tiles start at offsets aligned to four
+ *    bytes.
+ *
+ * <strong>Raw tiles:</strong> Tiles in TilePackage::RGB565 and
+ * TilePackage::RGB565_RLE formats are stored already in 16bit RGB565 pixel
+ * format used by the display, so they don't need any decoding. Tile data
+ * start with width and height, followed by pixels (16bit little endian,
+ * row after row without any padding). RLE compressed pixels are stored as
+ * pairs of 16bit run length and pixel value.
+ */
+class TilePackage {
+    public:
+        /** @brief Tile data format */
+        enum Format {
+            IMAGE = 0,      /**< @brief Any image format supported by SDL_image */
+            RGB565 = 1,     /**< @brief Raw 16bit pixels */
+            RGB565_RLE = 2  /**< @brief RLE compressed raw 16bit pixels */
+        };
+
+        /**
+         * @brief Constructor
+         * @param file          Package file
+         *
+         * If the file cannot be opened or is not a valid package, prints
+         * message to stderr and the package is empty (see isValid()).
+         */
+        TilePackage(const std::string& file);
+
+        /** @brief Destructor, unmaps the file */
+        ~TilePackage(void);
+
+        /** @brief Whether the package was successfully opened */
+        inline bool isValid(void) const { return data != NULL; }
+
+        /** @brief Tile data format */
+        inline Format format(void) const { return _format; }
+
+        /** @brief Count of tiles in the package */
+        inline unsigned int count(void) const { return _count; }
+
+        /**
+         * @brief Find tile data
+         * @param coordinates   Tile coordinates
+         * @param tileData      Where to save pointer to tile data. The data
+         *  are valid until the package is destroyed.
+         * @param tileSize      Where to save tile data length
+         * @return Whether the tile is in the package
+         */
+        bool find(const TileCoordinates& coordinates, const unsigned char*& tileData, unsigned int& tileSize) const;
+
+        /**
+         * @brief Open tile data for reading
+         * @param coordinates   Tile coordinates
+         * @return Read-only SDL_RWops over the mapped tile data (e.g. for
+         *  IMG_Load_RW()), or NULL if the tile is not in the package. The
+         *  caller is responsible for closing it.
+         */
+        SDL_RWops* open(const TileCoordinates& coordinates) const;
+
+        /**
+         * @brief Raw tile
+         * @param coordinates   Tile coordinates
+         * @return Tile in RGB565 pixel format, or NULL if the tile is not in
+         *  the package, the package doesn't contain raw tiles or the tile is
+         *  corrupted. Surface of uncompressed tile points directly to the
+         *  mapped memory, so it must not be modified and must be freed
+         *  before the package is destroyed. The caller is responsible for
+         *  freeing it.
+         */
+        SDL_Surface* rawTile(const TileCoordinates& coordinates) const;
+
+        /**
+         * @brief Read 32bit little endian number
+         * @param position      Position of the number
+         */
+        static unsigned int read(const unsigned char* position);
+
+        /**
+         * @brief Read 16bit little endian number
+         * @param position      Position of the number
+         */
+        inline static unsigned int read16(const unsigned char* position) {
+            return position[0] | position[1] << 8;
+        }
+
+    private:
+        /* Index entry size in bytes */
+        static const unsigned int entrySize = 20;
+
+        /* Maximal raw tile width and height in pixels, larger tiles are
+           considered corrupted */
+        static const unsigned int maxTileSize = 1024;
+
+        MappedFile* mapped;
+        const unsigned char* data;
+        unsigned int size;
+        Format _format;
+        unsigned int _count;
+
+        void unmap(void);
+
+        /* Copying is not allowed (the mapping is owned by the instance) */
+        TilePackage(const TilePackage&);
+        TilePackage& operator=(const TilePackage&);
+};
+
+}}
+
+#endif
@@ -17,6 +17,7 @@
 
 #include <iostream>
 
+#include "Compositor.h"
 #include "Effects.h"
 #include "Matrix.cpp"
 
@@ -35,6 +36,7 @@ void Toolbar::configureCaptionPlace (SDL_Rect* _position, Align* _align) {
     flags = (flags & !(CAPTION_BESIDE_ICON | CAPTION_UNDER_ICON)) | CAPTION_IN_PLACE;
     captionPosition = _position;
     captionAlign = _align;
+    layoutGeneration = 0;
 }
 
 /* Přidání obrázku do toolbaru */
@@ -45,6 +47,7 @@ void Toolbar::addImage (SDL_Rect* _position, SDL_Surface** _image) {
     image.position = _position;
     image.image = _image;
     images.push_back(image);
+    layoutGeneration = 0;
 }
 
 /* Přidání položky do toolbaru */
@@ -59,10 +62,9 @@ Toolbar::itemId Toolbar::addItem (SDL_Rect* _position, int x, int y, int action,
     item.disabledIcon = disabledIcon;
     item.caption = caption;
     item.flags = flags;
-    items.push_back(item);
 
-    reloadItems();
-    return items.size()-1;
+    layoutGeneration = 0;
+    return insertItem(item);
 }
 
 /* Přidání textu do toolbaru */
@@ -105,105 +107,152 @@ bool Toolbar::click(int x, int y, int& action) {
     /* Pokud je toolbar schovaný, konec */
     if(flags & HIDDEN) return false;
 
-    /* Oblast toolbaru */
-    SDL_Rect area = Effects::align(screen, *align, *position);
-
+    updateLayout();
     if(!inArea(x, y, area)) return false;
 
-    /* Procházení jednotlivých ikon */
-    for(vector<ToolbarItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        if(!((*it).flags & DISABLED) && inArea(x, y, Effects::align(area, ALIGN_DEFAULT, *(*it).position))) {
-            actualItem = it;
-            action = select();
-            return true;
+    /* Sestavení indexu ikon z rozvržení, pokud se změnilo */
+    if(hitTestOutdated(area)) {
+        clearHitTargets(area);
+        for(vector<ItemLayout>::const_iterator it = itemLayouts.begin(); it != itemLayouts.end(); ++it) {
+            SDL_Rect itemArea = (*it).area;
+            itemArea.x -= area.x; itemArea.y -= area.y;
+            addHitTarget(itemArea, it-itemLayouts.begin());
         }
     }
 
+    /* Nalezení ikony */
+    int item = hitTest(area, x, y);
+    if(item != -1) {
+        actualItem = items.begin()+item;
+        damage();
+        action = select();
+    }
+
     return true;
 }
 
+/* Poškození oblasti toolbaru */
+void Toolbar::damage(void) {
+    /* Oblast toolbaru nezávisí na položkách. Pokud je rozvržení zastaralé
+       (např. při přidávání položek), spočítá se jen oblast, položky se
+       rozvrhnou až při vykreslení nebo kliknutí. */
+    if(layoutGeneration != Compositor::layoutGeneration())
+        Compositor::damage(Effects::align(screen, *align, *position));
+    else
+        Compositor::damage(area);
+}
+
+/* Oblast toolbaru */
+SDL_Rect Toolbar::bounds(void) {
+    updateLayout();
+    return area;
+}
+
+/* Aktualizace rozvržení */
+void Toolbar::updateLayout(void) {
+    if(layoutGeneration == Compositor::layoutGeneration()) return;
+    layoutGeneration = Compositor::layoutGeneration();
+    invalidateHitTest();
+
+    area = Effects::align(screen, *align, *position);
+    if(flags & CAPTION_IN_PLACE)
+        captionArea = Effects::align(area, ALIGN_DEFAULT, *captionPosition);
+
+    imageAreas.clear();
+    for(vector<Image>::const_iterator it = images.begin(); it != images.end(); ++it)
+        imageAreas.push_back(Effects::align(area, ALIGN_DEFAULT, *(*it).position));
+
+    /* Zarovnání ikon (nadpisek pod ikonou zachovává horizontální zarovnání
+       ikony, nadpisek vedle ikony vertikální) */
+    Align iconAlign = *itemAlign;
+    if(flags & CAPTION_UNDER_ICON) iconAlign = (Align) (*itemAlign & 0x0F);
+    else if(flags & CAPTION_BESIDE_ICON) iconAlign = (Align) (*itemAlign & 0xF0);
+
+    itemLayouts.clear();
+    for(vector<ToolbarItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
+        ItemLayout layout;
+        layout.area = Effects::align(area, ALIGN_DEFAULT, *(*it).position);
+        layout.captionArea = layout.area;
+
+        /* Pozice všech variant ikony */
+        SDL_Surface** icons[3] = {(*it).icon, (*it).activeIcon, (*it).disabledIcon};
+        for(int i = 0; i != 3; ++i) {
+            SDL_Surface* icon = icons[i] != NULL ? *icons[i] : NULL;
+            layout.icons[i] = Effects::align(layout.area, iconAlign, icon != NULL ? (*icon).w : 0, icon != NULL ? (*icon).h : 0);
+        }
+
+        /* Od prostoru popisku odečtení prostoru ikony */
+        if(!(flags & NO_ICON)) {
+            if(flags & CAPTION_UNDER_ICON) {
+                layout.captionArea.y += *iconSize; layout.captionArea.h -= *iconSize;
+            } else if(flags & CAPTION_BESIDE_ICON) {
+                layout.captionArea.x += *iconSize; layout.captionArea.w -= *iconSize;
+            }
+        }
+
+        itemLayouts.push_back(layout);
+    }
+}
+
 /* Zobrazení toolbaru */
 void Toolbar::view (void) {
     /* Pokud je toolbar schovaný, konec */
     if(flags & HIDDEN) return;
 
-    /* Pozice toolbaru */
-    SDL_Rect area = Effects::align(screen, *align, *position);
+    /* Předpočítané rozvržení */
+    updateLayout();
 
     /* Obrázky */
     for(vector<Image>::const_iterator it = images.begin(); it != images.end(); ++it) {
-        SDL_Rect imageArea = Effects::align(area, ALIGN_DEFAULT, *(*it).position);
+        SDL_Rect imageArea = imageAreas[it-images.begin()];
         SDL_Rect imageCrop = {0, 0, imageArea.w, imageArea.y};
         SDL_BlitSurface(*(*it).image, &imageCrop, screen, &imageArea);
     }
 
     /* Položky toolbaru */
     for(vector<ToolbarItem>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        SDL_Rect itemPosition = Effects::align(area, ALIGN_DEFAULT, *(*it).position);
+        const ItemLayout& layout = itemLayouts[it-items.begin()];
 
-        /* Ukazatel na správnou ikonu */
+        /* Ukazatel na správnou ikonu a její pozici */
         SDL_Surface** icon;
-        if((*it).flags & DISABLED) icon = (*it).disabledIcon;
-        else if(actualItem == it) icon = (*it).activeIcon;
-        else icon = (*it).icon;
+        int variant;
+        if((*it).flags & DISABLED) { icon = (*it).disabledIcon; variant = 2; }
+        else if(actualItem == it) { icon = (*it).activeIcon; variant = 1; }
+        else { icon = (*it).icon; variant = 0; }
 
-        /* Pokud jsou povoleny ikony */
+        /* Pokud jsou povoleny ikony (SDL_BlitSurface mění cílový obdélník) */
         if(!(flags & NO_ICON)) {
-            SDL_Rect iconPosition;
-
-            /* Nadpisek pod ikonou (zachování horizontálního zarovnání pro ikonu) */
-            if(flags & CAPTION_UNDER_ICON) {
-                iconPosition = Effects::align(itemPosition, (Align) (*itemAlign & 0x0F), (**icon).w, (**icon).h);
-
-                /* Od prostoru položky odečtení výšky ikony */
-                itemPosition.y += *iconSize; itemPosition.h -= *iconSize;
-            }
-
-            /* Nadpisek vedle ikony (zachování vertikálního zarovnání pro ikonu) */
-            else if(flags & CAPTION_BESIDE_ICON) {
-                iconPosition = Effects::align(itemPosition, (Align) (*itemAlign & 0xF0), (**icon).w, (**icon).h);
-
-                /* Od prostoru položky oddečtení šířky ikony */
-                itemPosition.x += *iconSize; itemPosition.w -= *iconSize;
-            }
-
-            /* Žádný nadpisek nebo nadpisek na centrálním místě */
-            else iconPosition = Effects::align(itemPosition, *itemAlign, (**icon).w, (**icon).h);
-
+            SDL_Rect iconPosition = layout.icons[variant];
             SDL_Rect iconCrop = {0, 0, iconPosition.w, iconPosition.h};
             SDL_BlitSurface(*icon, &iconCrop, screen, &iconPosition);
         }
 
         /* Vypsání textu položky. Pokud je povolena ikona, souřadnice byly upraveny dříve. */
         if(flags & (NO_ICON | CAPTION_BESIDE_ICON | CAPTION_UNDER_ICON) || (flags & CAPTION_IN_PLACE && it == actualItem)) {
-            SDL_Surface* text = (*Effects::textRenderFunction())(*captionFont, (*(*it).caption).c_str(), *captionColor);
+            int textW, textH;
+            Effects::textSize(*captionFont, *(*it).caption, textW, textH);
             SDL_Rect textPosition;
 
             /* Popisek na centralizovaném místě */
-            if(flags & CAPTION_IN_PLACE) {
-                textPosition = Effects::align(
-                    Effects::align(area, ALIGN_DEFAULT, *captionPosition),
-                    *captionAlign, (*text).w, (*text).h
-                );
-            }
+            if(flags & CAPTION_IN_PLACE)
+                textPosition = Effects::align(captionArea, *captionAlign, textW, textH);
 
             /* Popisek u ikony */
             else
-                textPosition = Effects::align(itemPosition, *itemAlign, (*text).w, (*text).h);
+                textPosition = Effects::align(layout.captionArea, *itemAlign, textW, textH);
 
             SDL_Rect textCrop = {0, 0, textPosition.w, textPosition.h};
-            SDL_BlitSurface(text, &textCrop, screen, &textPosition);
-            SDL_FreeSurface(text);
+            Effects::blitText(*captionFont, *(*it).caption, *captionColor, &textCrop, screen, &textPosition);
         }
     }
 
     /* Text toolbaru */
     for(vector<Text>::const_iterator it = texts.begin(); it != texts.end(); ++it) {
-        SDL_Surface* text = (*Effects::textRenderFunction())(*(*it).font, (*(*it).text).c_str(), *(*it).color);
-        SDL_Rect textPosition = Effects::align(*(*it).position, *(*it).align, (*text).w, (*text).h);
+        int textW, textH;
+        Effects::textSize(*(*it).font, *(*it).text, textW, textH);
+        SDL_Rect textPosition = Effects::align(*(*it).position, *(*it).align, textW, textH);
         SDL_Rect textCrop = {0, 0, textPosition.w, textPosition.h};
-        SDL_BlitSurface(text, &textCrop, screen, &textPosition);
-        SDL_FreeSurface(text);
+        Effects::blitText(*(*it).font, *(*it).text, *(*it).color, &textCrop, screen, &textPosition);
     }
 }
 
@@ -27,6 +27,7 @@
 
 #include "Matrix.h"
 #include "Mouse.h"
+#include "Scene.h"
 #include "utility.h"
 
 namespace Kompas { namespace Sdl {
@@ -67,7 +68,7 @@ struct ToolbarItem {
  * nejsou, hledá se v dalším sloupci. Analogický postup je ve vertikálním směru.
  * @todo Vypnutí "nekonečného procházení" ve flags
  */
-class Toolbar: public Matrix<ToolbarItem>, public Mouse {
+class Toolbar: public Matrix<ToolbarItem>, public Mouse, public SceneNode {
     public:
         /**
          * @brief Flags pro toolbar
@@ -129,7 +130,7 @@ class Toolbar: public Matrix<ToolbarItem>, public Mouse {
         Toolbar(SDL_Surface* _screen, SDL_Rect* _position, Align* _align, Align* _itemAlign, int* _iconSize, TTF_Font** _captionFont, SDL_Color* _captionColor, SDL_Color* _captionActiveColor, SDL_Color* _captionDisabledColor, int _flags):
             screen(_screen), position(_position), align(_align), itemAlign(_itemAlign),
             iconSize(_iconSize), captionFont(_captionFont), captionColor(_captionColor),
-            captionDisabledColor(_captionDisabledColor) {}
+            captionDisabledColor(_captionDisabledColor), layoutGeneration(0) {}
 
         /**
          * @brief Nastavení nadpisku na centrálním definovaném místě
@@ -230,10 +231,10 @@ class Toolbar: public Matrix<ToolbarItem>, public Mouse {
         bool click(int x, int y, int& action);
 
         /** @brief Schování toolbaru */
-        inline void hide(void) { flags |= HIDDEN; }
+        inline void hide(void) { flags |= HIDDEN; damage(); }
 
         /** @brief Povolení zobrazení toolbaru */
-        inline void show(void) { flags &= ~HIDDEN; }
+        inline void show(void) { flags &= ~HIDDEN; damage(); }
 
         /** @brief Zjištění, jestli je povoleno zobrazení toolbaru */
         inline operator bool(void) { return !(flags & HIDDEN); }
@@ -245,6 +246,20 @@ class Toolbar: public Matrix<ToolbarItem>, public Mouse {
          * popisky) a nakonec texty.
          */
         void view(void);
+
+        /** @brief Oblast toolbaru */
+        SDL_Rect bounds(void);
+
+        /** @brief Zda není toolbar schovaný */
+        inline bool isVisible(void) const { return !(flags & HIDDEN); }
+
+    protected:
+        /** @brief Nahlášení oblasti toolbaru jako poškozené */
+        void damage(void);
+
+        /** @brief Na zakázané položky nelze kliknout */
+        inline bool hitTargetEnabled(int id) const { return !(items[id].flags & DISABLED); }
+
     private:
 
         /** @brief Struktura obrázku */
@@ -277,6 +292,27 @@ class Toolbar: public Matrix<ToolbarItem>, public Mouse {
 
         std::vector<Image> images;  /**< @brief Vektor s obrázky */
         std::vector<Text> texts;    /**< @brief Vektor s texty */
+
+        /** @brief Rozvržení položky */
+        struct ItemLayout {
+            SDL_Rect area;          /**< @brief Oblast položky */
+            SDL_Rect captionArea;   /**< @brief Oblast popisku u ikony (oblast položky bez ikony) */
+            SDL_Rect icons[3];      /**< @brief Pozice ikony, aktivní ikony a zakázané ikony */
+        };
+
+        unsigned int layoutGeneration;  /**< @brief Generace rozvržení (0, pokud je potřeba přepočítat) */
+        SDL_Rect area;              /**< @brief Oblast toolbaru */
+        SDL_Rect captionArea;       /**< @brief Oblast centralizovaného popisku */
+        std::vector<SDL_Rect> imageAreas; /**< @brief Oblasti obrázků */
+        std::vector<ItemLayout> itemLayouts; /**< @brief Rozvržení položek */
+
+        /**
+         * @brief Aktualizace rozvržení
+         *
+         * Přepočítá oblasti toolbaru, obrázků a položek, pokud se změnila
+         * generace rozvržení (viz Compositor::layoutGeneration) nebo položky.
+         */
+        void updateLayout(void);
 };
 
 }}
@@ -13,16 +13,23 @@
     GNU Lesser General Public License version 3 for more details.
 */
 
+#include <dirent.h>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 
+#include "Compositor.h"
+#include "ConfParser.h"
+#include "Effects.h"
 #include "FPS.h"
 #include "Keyboard.h"
 #include "Localize.h"
 #include "Menu.h"
 #include "Map.h"
+#include "TileCache.h"
+#include "Scene.h"
 #include "Skin.h"
 #include "Splash.h"
 #include "Toolbar.h"
@@ -62,6 +69,15 @@ int main(int argc, char **argv) {
 
     cout << "Kompas2 -- třetí pokus o nemožné. © Vladimír Vondruš, 21.06.2009" << endl;
 
+    /* Vypnutí cache konfiguráků (pro porovnání doby spuštění), sledování
+       změn skinu, líné dekódování obrázků skinu */
+    bool watchSkin = false;
+    for(int i = 1; i < argc; ++i) {
+        if(string(argv[i]) == "--no-conf-cache") ConfParser::cache = false;
+        else if(string(argv[i]) == "--watch-skin") watchSkin = true;
+        else if(string(argv[i]) == "--lazy-skin") Skin::lazy = true;
+    }
+
     /* Inicializace SDL */
     if (SDL_Init (SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_TIMER) < 0) {
         cerr << "Nelze inicializovat SDL: " << SDL_GetError() << endl;
@@ -87,6 +103,8 @@ int main(int argc, char **argv) {
 
     /* Nastavení skinu */
     Skin skin(screen, "skin.conf");
+    if(watchSkin && !skin.watch(true))
+        cerr << "Sledování změn skinu není podporováno." << endl;
     int dummy = 0;
 
     /* Lokalizace */
@@ -147,7 +165,10 @@ int main(int argc, char **argv) {
     enum Actions {
         ZOOMIN, ZOOMOUT, OPEN, SAVE, OPTIONS, MAPOPTIONS, EXIT,
         OPTIONS_FPS, OPTIONS_LANGUAGE, OPTIONS_SMOOTHTEXT, OPTIONS_ABOUT,
-        OPTIONS_CHANGEABLE_TEXT
+        OPTIONS_CHANGEABLE_TEXT,
+
+        /* Otevření n-tého balíčku je akce OPEN_PACKAGE+n */
+        OPEN_PACKAGE
     };
 
     Align* menuItemsAlign = skin.get<Align*>("itemsAlign", "menu");
@@ -164,6 +185,24 @@ int main(int argc, char **argv) {
     /* Sekce otevření mapového balíčku */
     Menu::sectionId openSection = menu.addSection(1, lang.get("open", "toolbar"), NULL, menuItemsAlign, 0);
 
+    /* Nalezení mapových balíčků (viz TilePackage) v adresáři maps */
+    vector<string> packages;
+    DIR* packageDirectory = opendir("maps");
+    if(packageDirectory != NULL) {
+        dirent* entry;
+        while((entry = readdir(packageDirectory)) != NULL) {
+            string name = (*entry).d_name;
+            if(name.size() > 5 && name.substr(name.size()-5) == ".ktpk")
+                packages.push_back(name);
+        }
+        closedir(packageDirectory);
+    }
+
+    /* Položky se přidávají až po naplnění vektoru, aby se při realokaci
+       nezměnily ukazatele na jejich popisky */
+    for(vector<string>::size_type i = 0; i != packages.size(); ++i)
+        menu.addItem(openSection, OPEN_PACKAGE+i, &packages[i]);
+
     /* Toolbar */
     Toolbar toolbar(screen,
         skin.get<SDL_Rect*>("", "toolbar"),
@@ -232,15 +271,41 @@ int main(int argc, char **argv) {
         NULL, lang.get("exit", "toolbar")
     );
 
-    TTF_Font** mFont = skin.get<TTF_Font**>("captionFont", "toolbar");
-    SDL_Color* mColor = skin.get<SDL_Color*>("captionColor", "toolbar");
-
     /* Klávesnice */
     Keyboard keyboard(screen, skin, "keyboard/cz.conf", text, Keyboard::HIDDEN);
 
     /* Mapa */
-    Map map(screen, NULL,
-        skin.get<SDL_Surface**>("tileNotFound", "map"));
+    Map map(screen,
+        skin.get<SDL_Surface**>("tileLoading", "map"),
+        skin.get<SDL_Surface**>("tileNotFound", "map"),
+        skin.get<int*>("tileCacheSize", "map"),
+        skin.get<int*>("tilePrefetchDepth", "map"),
+        "tiles");
+    map.configureLabels(
+        skin.get<TTF_Font**>("captionFont", "toolbar"),
+        skin.get<SDL_Color*>("captionColor", "toolbar")
+    );
+
+    /* Scéna, objekty odspodu nahoru */
+    Scene scene;
+    scene.add(&splash, 0);
+    scene.add(&map, 1);
+    scene.add(&toolbar, 2);
+    scene.add(&menu, 3);
+    scene.add(&keyboard, 4);
+
+    /* Všechny obrázky skinu jsou zažádané, počkání na jejich dekódování. V
+       líném režimu jen na ty, které jsou vidět v prvním snímku, ostatní se
+       dekódují až po něm. */
+    skin.require("splash");
+    skin.require("toolbar");
+    skin.require("map");
+    skin.finishLoading();
+    bool skinWarmedUp = false;
+
+    /* Doba spuštění (od inicializace SDL po hlavní smyčku), hlavně načítání
+       konfiguráků, skinu a lokalizace */
+    unsigned int startupTime = SDL_GetTicks();
 
     /* Hlavní smyčka programu */
     FPS(); FPS::limit = 50;
@@ -248,6 +313,21 @@ int main(int argc, char **argv) {
     while (!done) {
         int action = -1;
 
+        /* Pokud se nic nemění, uspání do další události (vstup, načtená
+           dlaždice) nebo do přebliknutí kurzoru klávesnice */
+        if(!Compositor::damaged() && !map.busy()) {
+            /* Při sledování skinu kontrola změn aspoň dvakrát za sekundu */
+            int timeout = keyboard.nextUpdate();
+            if(skin.isWatching() && (timeout == -1 || timeout > 500))
+                timeout = 500;
+            FPS::wait(timeout);
+        }
+
+        /* Znovunačtení změněných souborů skinu, převzetí obrázků dekódovaných
+           na pozadí */
+        skin.reloadChanged();
+        skin.update();
+
         /* Projití událostí */
         SDL_Event event;
         while (SDL_PollEvent (&event)) {
@@ -290,6 +370,10 @@ int main(int argc, char **argv) {
                             else if(menu) action = menu.select();
                             else if(toolbar) action = toolbar.select();
                             break;
+                        case SDLK_l:
+                            /* Zapnutí / vypnutí popisků dlaždic */
+                            map.setTileLabels(!map.tileLabels());
+                            break;
                         case SDLK_PAGEUP:
                             if(menu) menu.scrollUp();
                             break;
@@ -310,6 +394,10 @@ int main(int argc, char **argv) {
                     } break;
                 case SDL_VIDEORESIZE:
                     screen = SDL_SetVideoMode(event.resize.w, event.resize.h, 16, SDL_SWSURFACE|SDL_RESIZABLE);
+                    Compositor::invalidateLayout();
+                    break;
+                case SDL_VIDEOEXPOSE:
+                    Compositor::damage();
                     break;
                 case SDL_QUIT:
                     done = 1;
@@ -337,18 +425,76 @@ int main(int argc, char **argv) {
                 keyboard.show();
                 break;
             default:
+                /* Otevření mapového balíčku */
+                if(action >= OPEN_PACKAGE && action < OPEN_PACKAGE+(int) packages.size()) {
+                    if(map.open("maps/" + packages[action-OPEN_PACKAGE])) menu.hide();
+                }
                 break;
         }
 
-        skinText = *skinAuthor + *author;
-        splash.view();
-        map.view(mFont, mColor);
-        toolbar.view();
-        menu.view();
-        keyboard.view();
-        SDL_UpdateRect(screen, 0, 0, 0, 0);
+        /* Aktualizace stavu nezávislá na vykreslování */
+        map.update();
+        keyboard.update();
+
+        /* Text splashe se mění jen se skinem nebo jazykem */
+        string newSkinText = *skinAuthor + *author;
+        if(newSkinText != skinText) {
+            skinText = newSkinText;
+            Compositor::damage();
+        }
+
+        /* Překreslení jen poškozených oblastí. Poškození nahlášené během
+           vykreslování (např. změna fontu popisků mapy) vydrží do dalšího
+           snímku. */
+        scene.render(screen);
+
         FPS::refresh();
+
+        /* První snímek je zobrazen, dekódování zbytku skinu na pozadí */
+        if(!skinWarmedUp) {
+            skin.warmUp();
+            skinWarmedUp = true;
+        }
     }
 
+    /* Doba spuštění */
+    cout << "Spuštění: " << startupTime << " ms ("
+         << (ConfParser::cache ? "s cache konfiguráků" : "bez cache konfiguráků") << ")" << endl;
+
+    /* Statistiky časů snímků */
+    cout << "Časy snímků: " << FPS::frameCount() << " snímků, p50 "
+         << FPS::percentile(50) << " ms, p95 " << FPS::percentile(95)
+         << " ms, p99 " << FPS::percentile(99) << " ms, max "
+         << FPS::maxFrameTime() << " ms, " << FPS::missedDeadlines()
+         << " zmeškaných termínů" << endl;
+
+    /* Statistiky scény */
+    cout << "Scéna: " << scene.drawnCount() << " vykreslení objektů, "
+         << scene.culledCount() << " přeskočených" << endl;
+
+    /* Statistiky cache textů */
+    cout << "Cache textů: " << Effects::textCacheHits() << " zásahů, "
+         << Effects::textCacheMisses() << " výpadků, "
+         << Effects::textCacheEvictions() << " vyhozených" << endl;
+
+    /* Statistiky sdílení obrázků a fontů skinu */
+    cout << "Skin: " << skin.duplicateImages() << " obrázků a "
+         << skin.duplicateFonts() << " fontů sdíleno, ušetřeno "
+         << skin.sharedImageSize()/1024 << " kB, "
+         << skin.atlasImageCount() << " obrázků v " << skin.atlasCount()
+         << " atlasech" << endl;
+
+    /* Statistiky cache dlaždic */
+    cout << "Cache dlaždic: " << map.tileCache().hits() << " zásahů, "
+         << map.tileCache().misses() << " výpadků, "
+         << map.tileCache().evictions() << " vyhozených, "
+         << map.tileCache().size()/1024 << " kB v " << map.tileCache().count()
+         << " dlaždicích" << endl;
+    cout << "Předem načtené dlaždice: " << map.prefetchHits() << " použitých z "
+         << map.prefetchRequests() << " zažádaných";
+    if(map.prefetchRequests() != 0)
+        cout << " (" << map.prefetchHits()*100/map.prefetchRequests() << " %)";
+    cout << endl;
+
     return 0;
 }
@@ -0,0 +1,236 @@
+/*
+    Copyright © 2007, 2008, 2009, 2010, 2011 Vladimír Vondruš <mosra@centrum.cz>
+
+    This file is part of Kompas.
+
+    Kompas is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License version 3
+    only, as published by the Free Software Foundation.
+
+    Kompas is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License version 3 for more details.
+*/
+
+/** @file
+ * @brief Offline converter of tile directories to tile packages
+ *
+ * Converts directory with tiles in @c zoom/x/y.png layout (the one read by
+ * TileLoader) into single TilePackage file. Tiles are either copied as they
+ * are or converted to raw RGB565 format (optionally RLE compressed), which
+ * doesn't need any decoding when displayed.
+ *
+ * Usage: <tt>kompas-tilepackage [--raw|--rle] directory package.ktpk</tt>
+ */
+
+#include <algorithm>    /* sort() */
+#include <cstdlib>      /* strtoul() */
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>     /* istreambuf_iterator */
+#include <sstream>
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+
+#include "TilePackage.h"
+
+using namespace std;
+using namespace Kompas::Sdl;
+
+struct Entry {
+    TileCoordinates coordinates;
+    string file;
+    unsigned int offset, length;
+
+    inline bool operator<(const Entry& other) const {
+        return coordinates < other.coordinates;
+    }
+};
+
+/* Numeric entries in given directory */
+vector<unsigned int> numbers(const string& directory, const string& suffix = "") {
+    vector<unsigned int> found;
+    DIR* dir = opendir(directory.c_str());
+    if(dir == NULL) return found;
+
+    dirent* entry;
+    while((entry = readdir(dir)) != NULL) {
+        string name = (*entry).d_name;
+        if(name.size() <= suffix.size() || name.substr(name.size()-suffix.size()) != suffix)
+            continue;
+
+        char* end;
+        unsigned int number = strtoul(name.c_str(), &end, 10);
+        if(end != name.c_str() && string(end) == suffix) found.push_back(number);
+    }
+    closedir(dir);
+
+    return found;
+}
+
+/* Little endian number (of given size in bytes) */
+void append(string& out, unsigned int number, unsigned int size = 4) {
+    for(unsigned int i = 0; i != size; ++i)
+        out += (char) ((number >> i*8) & 0xFF);
+}
+
+void write(ostream& out, unsigned int number) {
+    string bytes;
+    append(bytes, number);
+    out.write(bytes.data(), 4);
+}
+
+/* Tile data in given format */
+bool convert(const string& file, TilePackage::Format format, string& data) {
+    data.clear();
+
+    /* Image file is copied as is */
+    if(format == TilePackage::IMAGE) {
+        ifstream in(file.c_str(), ios::binary);
+        if(!in.good()) return false;
+        data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        return true;
+    }
+
+    SDL_Surface* image = IMG_Load(file.c_str());
+    if(!image) return false;
+
+    /* Conversion to RGB565 */
+    SDL_Surface* raw = SDL_CreateRGBSurface(SDL_SWSURFACE, (*image).w, (*image).h, 16, 0xF800, 0x07E0, 0x001F, 0);
+    if(!raw) {
+        cerr << "Cannot create RGB565 surface: " << SDL_GetError() << endl;
+        SDL_FreeSurface(image);
+        return false;
+    }
+    SDL_BlitSurface(image, NULL, raw, NULL);
+    SDL_FreeSurface(image);
+
+    append(data, (*raw).w);
+    append(data, (*raw).h);
+
+    unsigned int run = 0;
+    Uint16 last = 0;
+    for(int y = 0; y != (*raw).h; ++y) {
+        const Uint16* line = reinterpret_cast<const Uint16*>(static_cast<const Uint8*>((*raw).pixels)+y*(*raw).pitch);
+        for(int x = 0; x != (*raw).w; ++x) {
+            if(format == TilePackage::RGB565) {
+                append(data, line[x], 2);
+                continue;
+            }
+
+            /* RLE: run of the same pixels ended */
+            if(run != 0 && (line[x] != last || run == 0xFFFF)) {
+                append(data, run, 2);
+                append(data, last, 2);
+                run = 0;
+            }
+            last = line[x];
+            ++run;
+        }
+    }
+    if(run != 0) {
+        append(data, run, 2);
+        append(data, last, 2);
+    }
+
+    SDL_FreeSurface(raw);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    TilePackage::Format format = TilePackage::IMAGE;
+    int arg = 1;
+    if(arg < argc && string(argv[arg]) == "--raw") {
+        format = TilePackage::RGB565; ++arg;
+    } else if(arg < argc && string(argv[arg]) == "--rle") {
+        format = TilePackage::RGB565_RLE; ++arg;
+    }
+
+    if(argc-arg != 2) {
+        cerr << "Usage: " << argv[0] << " [--raw|--rle] directory package.ktpk" << endl;
+        return 1;
+    }
+    string directory = argv[arg], output = argv[arg+1];
+
+    /* Gathering tiles from directory/zoom/x/y.png */
+    vector<Entry> entries;
+    vector<unsigned int> zooms = numbers(directory);
+    for(vector<unsigned int>::const_iterator zoom = zooms.begin(); zoom != zooms.end(); ++zoom) {
+        ostringstream zoomDirectory;
+        zoomDirectory << directory << '/' << *zoom;
+
+        vector<unsigned int> xs = numbers(zoomDirectory.str());
+        for(vector<unsigned int>::const_iterator x = xs.begin(); x != xs.end(); ++x) {
+            ostringstream xDirectory;
+            xDirectory << zoomDirectory.str() << '/' << *x;
+
+            vector<unsigned int> ys = numbers(xDirectory.str(), ".png");
+            for(vector<unsigned int>::const_iterator y = ys.begin(); y != ys.end(); ++y) {
+                ostringstream file;
+                file << xDirectory.str() << '/' << *y << ".png";
+
+                Entry entry;
+                TileCoordinates coordinates = {*zoom, *x, *y};
+                entry.coordinates = coordinates;
+                entry.file = file.str();
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    /* Index must be sorted for binary search */
+    sort(entries.begin(), entries.end());
+
+    ofstream out(output.c_str(), ios::binary);
+    if(!out.good()) {
+        cerr << "Cannot open " << output << " for writing" << endl;
+        return 2;
+    }
+
+    /* Header, placeholder for index */
+    out.write("KTPK", 4);
+    write(out, 1);
+    write(out, format);
+    write(out, entries.size());
+    unsigned int offset = 16+entries.size()*20;
+    out.write(string(entries.size()*20, '\0').data(), entries.size()*20);
+
+    /* Tile data, aligned to four bytes */
+    string data;
+    vector<Entry>::iterator it = entries.begin();
+    while(it != entries.end()) {
+        if(!convert((*it).file, format, data)) {
+            cerr << "Cannot convert " << (*it).file << ", skipping" << endl;
+            it = entries.erase(it);
+            continue;
+        }
+
+        (*it).offset = offset;
+        (*it).length = data.size();
+        out.write(data.data(), data.size());
+        offset += data.size();
+
+        string padding((4-offset%4)%4, '\0');
+        out.write(padding.data(), padding.size());
+        offset += padding.size();
+        ++it;
+    }
+
+    /* Index (and count, if some tiles were skipped) */
+    out.seekp(12);
+    write(out, entries.size());
+    for(vector<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        write(out, (*it).coordinates.zoom);
+        write(out, (*it).coordinates.x);
+        write(out, (*it).coordinates.y);
+        write(out, (*it).offset);
+        write(out, (*it).length);
+    }
+
+    cout << "Written " << entries.size() << " tiles to " << output << endl;
+    return out.good() ? 0 : 3;
+}
@@ -38,6 +38,35 @@ enum Align {
     ALIGN_BOTTOM = 0x40     /**< @brief Bottom */
 };
 
+/**
+ * @brief Map tile coordinates
+ *
+ * Identifies one map tile. Comparable, so it can be used as a key in sorted
+ * containers.
+ */
+struct TileCoordinates {
+    unsigned int zoom,      /**< @brief Zoom level */
+        x,                  /**< @brief X coordinate */
+        y;                  /**< @brief Y coordinate */
+
+    /** @brief Equality operator */
+    inline bool operator==(const TileCoordinates& other) const {
+        return zoom == other.zoom && x == other.x && y == other.y;
+    }
+
+    /** @brief Inequality operator */
+    inline bool operator!=(const TileCoordinates& other) const {
+        return !operator==(other);
+    }
+
+    /** @brief Ordering operator (by zoom, then x, then y) */
+    inline bool operator<(const TileCoordinates& other) const {
+        if(zoom != other.zoom) return zoom < other.zoom;
+        if(x != other.x) return x < other.x;
+        return y < other.y;
+    }
+};
+
 /**
  * @brief Look up position of next character in UTF-8 string
  * @param str           UTF-8 string